@@ -0,0 +1,323 @@
+#ifndef ASYNCSEGMENTDEQUE_HPP
+#define ASYNCSEGMENTDEQUE_HPP
+
+#include "SegmentDeque.hpp"
+
+// Coroutine support needs a C++20 compiler (-std=c++20); in C++17 builds this header is empty.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Lazily produced sequence of values, consumed with range-for. Each co_yield suspends the
+// coroutine until the consumer asks for the next value; exceptions reach the consumer.
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        const T* current = nullptr;
+        std::exception_ptr error;
+
+        Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { error = std::current_exception(); }
+
+        std::suspend_always yield_value(const T& value) noexcept {
+            current = std::addressof(value);
+            return {};
+        }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        explicit Iterator(Handle handle) : handle(handle) {}
+
+        const T& operator*() const { return *handle.promise().current; }
+        const T* operator->() const { return handle.promise().current; }
+
+        Iterator& operator++() {
+            Advance(handle);
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return !handle || handle.done(); }
+        bool operator!=(std::default_sentinel_t sentinel) const { return !(*this == sentinel); }
+    private:
+        Handle handle;
+    };
+
+    Generator(Generator&& generator) noexcept : handle(std::exchange(generator.handle, nullptr)) {}
+
+    Generator& operator=(Generator&& generator) noexcept {
+        if (this != &generator) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(generator.handle, nullptr);
+        }
+
+        return *this;
+    }
+
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+
+    ~Generator() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    // Starts the coroutine; a generator can be iterated once.
+    Iterator begin() {
+        if (handle) {
+            Advance(handle);
+        }
+
+        return Iterator(handle);
+    }
+
+    std::default_sentinel_t end() { return {}; }
+private:
+    Handle handle;
+
+    explicit Generator(Handle handle) : handle(handle) {}
+
+    static void Advance(Handle handle) {
+        handle.resume();
+
+        if (handle.done() && handle.promise().error) {
+            std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+        }
+    }
+};
+
+// Yields the elements of deque front to back. The deque must outlive the generator and must
+// not be modified while it is being consumed.
+template <typename T, size_t InlineCapacity>
+Generator<T> Generate(const SegmentDeque<T, InlineCapacity>& deque) {
+    for (const T& value : deque) {
+        co_yield value;
+    }
+}
+
+class SingleThreadExecutor;
+
+// Coroutine started by a SingleThreadExecutor. It does not run until it is spawned.
+class Task {
+public:
+    struct promise_type {
+        std::exception_ptr error;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task(Task&& task) noexcept : handle(std::exchange(task.handle, nullptr)) {}
+
+    Task& operator=(Task&& task) noexcept {
+        if (this != &task) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(task.handle, nullptr);
+        }
+
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool IsDone() const { return !handle || handle.done(); }
+private:
+    friend class SingleThreadExecutor;
+
+    Handle handle;
+
+    explicit Task(Handle handle) : handle(handle) {}
+};
+
+// Runs coroutines on the calling thread: Spawn and Schedule queue them, Run resumes them in
+// FIFO order until nothing is ready.
+class SingleThreadExecutor {
+public:
+    SingleThreadExecutor() = default;
+    SingleThreadExecutor(const SingleThreadExecutor&) = delete;
+    SingleThreadExecutor& operator=(const SingleThreadExecutor&) = delete;
+
+    void Spawn(Task task) {
+        ready.Append(task.handle);
+        tasks.push_back(std::move(task));
+    }
+
+    void Schedule(std::coroutine_handle<> handle) {
+        ready.Append(handle);
+    }
+
+    // Returns the number of resumptions. A finished task that threw is removed and its
+    // exception is rethrown once the ready queue is drained.
+    size_t Run() {
+        size_t resumed = 0;
+
+        while (!ready.IsEmpty()) {
+            std::coroutine_handle<> handle = ready[0];
+            ready.PopFront();
+            handle.resume();
+            resumed++;
+        }
+
+        std::exception_ptr error;
+        std::vector<Task> pending;
+
+        for (Task& task : tasks) {
+            if (!task.IsDone()) {
+                pending.push_back(std::move(task));
+            } else if (!error && task.handle.promise().error) {
+                error = task.handle.promise().error;
+            }
+        }
+
+        tasks = std::move(pending);
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        return resumed;
+    }
+
+    // Spawned tasks that have not finished, i.e. are suspended waiting for something.
+    size_t GetPendingTaskCount() const {
+        size_t count = 0;
+
+        for (const Task& task : tasks) {
+            count += task.IsDone() ? 0 : 1;
+        }
+
+        return count;
+    }
+private:
+    SegmentDeque<std::coroutine_handle<>> ready;
+    std::vector<Task> tasks;
+};
+
+// FIFO queue for coroutines on one SingleThreadExecutor: co_await PopFront() suspends while the
+// queue is empty, and Append hands its value straight to the longest waiting consumer and
+// schedules it. After Close, waiting and later consumers get std::nullopt once the queue is
+// drained. Not thread-safe.
+template <typename T>
+class AsyncSegmentDeque {
+private:
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        std::optional<T>* slot;
+    };
+public:
+    class PopAwaiter {
+    public:
+        explicit PopAwaiter(AsyncSegmentDeque& deque) : deque(&deque) {}
+
+        bool await_ready() const noexcept {
+            return !deque->items.IsEmpty() || deque->closed;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            deque->waiters.Append(Waiter{handle, &value});
+        }
+
+        std::optional<T> await_resume() {
+            if (value) {
+                return std::move(value);
+            }
+
+            if (deque->items.IsEmpty()) {
+                return std::nullopt;
+            }
+
+            std::optional<T> result(std::move(deque->items[0]));
+            deque->items.PopFront();
+            return result;
+        }
+    private:
+        AsyncSegmentDeque* deque;
+        std::optional<T> value;
+    };
+
+    explicit AsyncSegmentDeque(SingleThreadExecutor& executor, size_t segment_capacity = 16)
+        : executor(&executor), items(segment_capacity), closed(false) {}
+
+    AsyncSegmentDeque(const AsyncSegmentDeque&) = delete;
+    AsyncSegmentDeque& operator=(const AsyncSegmentDeque&) = delete;
+
+    void Append(const T& value) {
+        if (closed) {
+            throw std::runtime_error("Append to closed deque");
+        }
+
+        if (waiters.IsEmpty()) {
+            items.Append(value);
+            return;
+        }
+
+        Waiter waiter = waiters[0];
+        waiters.PopFront();
+        waiter.slot->emplace(value);
+        executor->Schedule(waiter.handle);
+    }
+
+    PopAwaiter PopFront() {
+        return PopAwaiter(*this);
+    }
+
+    void Close() {
+        closed = true;
+
+        while (!waiters.IsEmpty()) {
+            executor->Schedule(waiters[0].handle);
+            waiters.PopFront();
+        }
+    }
+
+    bool IsClosed() const { return closed; }
+    size_t GetSize() const { return items.GetSize(); }
+    size_t GetWaitingCount() const { return waiters.GetSize(); }
+private:
+    SingleThreadExecutor* executor;
+    SegmentDeque<T> items;
+    SegmentDeque<Waiter> waiters;
+    bool closed;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,914 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include "SegmentDeque.hpp"
+#include "DequeIO.hpp"
+#include "SummarizedSegmentDeque.hpp"
+#include "WindowedSegmentDeque.hpp"
+#include "ConcurrentSegmentDeque.hpp"
+#include "BoundedSegmentQueue.hpp"
+#include "lib/UnrolledListSequence.hpp"
+
+class Benchmarks {
+public:
+    static void RunAllBenchmarks() {
+        std::cout << "Running SegmentDeque Benchmarks\n";
+        BenchmarkSequences();
+        BenchmarkLinkedListNodes();
+        BenchmarkCheckedAccess();
+        BenchmarkTraversal();
+        BenchmarkReserve();
+        BenchmarkSmallDeques();
+        BenchmarkSort();
+        BenchmarkBinarySearch();
+        BenchmarkRangeReduce();
+        BenchmarkSlidingWindow();
+        BenchmarkLoadSave();
+        BenchmarkWriteTo();
+        BenchmarkFlatMap();
+        BenchmarkWhere();
+        BenchmarkInPlace();
+        BenchmarkConcurrentQueue();
+        BenchmarkBoundedQueue();
+        BenchmarkSegmentLayout();
+        std::cout << "All benchmarks finished\n";
+    }
+
+private:
+    static volatile long long sink;
+
+    // The hand-rolled bounded queue BoundedSegmentQueue replaces: one condition variable per
+    // side and a broadcast on every push and pop.
+    template <typename T>
+    class BroadcastBoundedQueue {
+    public:
+        explicit BroadcastBoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+        bool Push(const T& value) {
+            std::unique_lock<std::mutex> guard(lock);
+            not_full.wait(guard, [&]() { return closed || items.GetSize() < capacity; });
+            if (closed) {
+                return false;
+            }
+            items.Append(value);
+            not_empty.notify_all();
+            return true;
+        }
+
+        bool Pop(T& value) {
+            std::unique_lock<std::mutex> guard(lock);
+            not_empty.wait(guard, [&]() { return closed || !items.IsEmpty(); });
+            if (items.IsEmpty()) {
+                return false;
+            }
+            value = items[0];
+            items.PopFront();
+            not_full.notify_all();
+            return true;
+        }
+
+        void Close() {
+            std::lock_guard<std::mutex> guard(lock);
+            closed = true;
+            not_full.notify_all();
+            not_empty.notify_all();
+        }
+    private:
+        std::mutex lock;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+        SegmentDeque<T> items;
+        size_t capacity;
+        bool closed;
+    };
+
+    // The baseline for ConcurrentSegmentDeque: one mutex around a std::deque.
+    template <typename T>
+    class LockedStdDeque {
+    public:
+        void Append(const T& value) {
+            std::lock_guard<std::mutex> guard(lock);
+            items.push_back(value);
+        }
+
+        void Append(const T* values, size_t count) {
+            std::lock_guard<std::mutex> guard(lock);
+            items.insert(items.end(), values, values + count);
+        }
+
+        bool TryPopFront(T& value) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (items.empty()) {
+                return false;
+            }
+            value = items.front();
+            items.pop_front();
+            return true;
+        }
+
+        size_t PopFront(T* output, size_t max_count) {
+            std::lock_guard<std::mutex> guard(lock);
+            size_t count = max_count < items.size() ? max_count : items.size();
+            std::copy(items.begin(), items.begin() + count, output);
+            items.erase(items.begin(), items.begin() + count);
+            return count;
+        }
+    private:
+        std::mutex lock;
+        std::deque<T> items;
+    };
+
+    template <typename Func>
+    static double MeasureMs(Func func) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto finish = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::milli>(finish - start).count();
+    }
+
+    static void Report(const std::string& name, double ms) {
+        std::cout << "  " << std::left << std::setw(44) << name << std::right << std::setw(10)
+                  << std::fixed << std::setprecision(2) << ms << " ms\n";
+    }
+
+    static void BenchmarkLinkedListNodes() {
+        std::cout << "LinkedList nodes (slab pool) vs std::list (malloc per node)\n";
+
+        const int COUNT = 1000000;
+
+        {
+            LinkedList<int>* list = new LinkedList<int>();
+
+            Report("LinkedList append", MeasureMs([&]() {
+                for (int i = 0; i < COUNT; i++) {
+                    list->Append(i);
+                }
+            }));
+
+            Report("LinkedList traverse", MeasureMs([&]() {
+                long long sum = 0;
+                for (int value : *list) {
+                    sum += value;
+                }
+                sink = sum;
+            }));
+
+            LinkedList<int>* copy = nullptr;
+            Report("LinkedList copy", MeasureMs([&]() {
+                copy = new LinkedList<int>(*list);
+            }));
+
+            Report("LinkedList destroy", MeasureMs([&]() {
+                delete copy;
+                delete list;
+            }));
+        }
+
+        {
+            std::list<int>* list = new std::list<int>();
+
+            Report("std::list append", MeasureMs([&]() {
+                for (int i = 0; i < COUNT; i++) {
+                    list->push_back(i);
+                }
+            }));
+
+            Report("std::list traverse", MeasureMs([&]() {
+                long long sum = 0;
+                for (int value : *list) {
+                    sum += value;
+                }
+                sink = sum;
+            }));
+
+            std::list<int>* copy = nullptr;
+            Report("std::list copy", MeasureMs([&]() {
+                copy = new std::list<int>(*list);
+            }));
+
+            Report("std::list destroy", MeasureMs([&]() {
+                delete copy;
+                delete list;
+            }));
+        }
+    }
+
+    template <typename SequenceType>
+    static void BenchmarkSequence(const std::string& name, int count) {
+        SequenceType sequence;
+
+        Report(name + " append", MeasureMs([&]() {
+            for (int i = 0; i < count; i++) {
+                sequence.Append(i);
+            }
+        }));
+
+        Report(name + " Get(i) loop", MeasureMs([&]() {
+            long long sum = 0;
+            for (size_t i = 0; i < sequence.GetSize(); i++) {
+                sum += sequence.Get(i);
+            }
+            sink = sum;
+        }));
+
+        Report(name + " insert in the middle", MeasureMs([&]() {
+            for (int i = 0; i < 1000; i++) {
+                sequence.InsertAt(i, sequence.GetSize() / 2);
+            }
+        }));
+    }
+
+    static void BenchmarkSequences() {
+        std::cout << "Sequences, 20000 elements\n";
+
+        const int COUNT = 20000;
+
+        BenchmarkSequence<UnrolledListSequence<int>>("UnrolledListSequence", COUNT);
+        BenchmarkSequence<ListSequence<int>>("ListSequence", COUNT);
+        BenchmarkSequence<MutableArraySequence<int>>("MutableArraySequence", COUNT);
+    }
+
+    static void BenchmarkCheckedAccess() {
+#ifdef NDEBUG
+        std::cout << "Checked Get/At vs unchecked operator[] (release build)\n";
+#else
+        std::cout << "Checked Get/At vs operator[] (debug build: operator[] is checked too)\n";
+#endif
+
+        const int COUNT = 10000000;
+        const int REPEATS = 5;
+
+        DynamicArray<int> array(COUNT);
+        for (int i = 0; i < COUNT; i++) {
+            array[i] = i;
+        }
+
+        Report("DynamicArray Get", MeasureMs([&]() {
+            long long sum = 0;
+            for (int r = 0; r < REPEATS; r++) {
+                for (size_t i = 0; i < array.GetSize(); i++) {
+                    sum += array.Get(i);
+                }
+            }
+            sink = sum;
+        }));
+
+        Report("DynamicArray operator[]", MeasureMs([&]() {
+            long long sum = 0;
+            for (int r = 0; r < REPEATS; r++) {
+                for (size_t i = 0; i < array.GetSize(); i++) {
+                    sum += array[i];
+                }
+            }
+            sink = sum;
+        }));
+
+        MutableArraySequence<int> sequence(COUNT);
+        Sequence<int>* base = &sequence;
+
+        Report("ArraySequence virtual Get", MeasureMs([&]() {
+            long long sum = 0;
+            for (int r = 0; r < REPEATS; r++) {
+                for (size_t i = 0; i < base->GetSize(); i++) {
+                    sum += base->Get(i);
+                }
+            }
+            sink = sum;
+        }));
+
+        Report("ArraySequence operator[]", MeasureMs([&]() {
+            long long sum = 0;
+            for (int r = 0; r < REPEATS; r++) {
+                for (size_t i = 0; i < sequence.GetSize(); i++) {
+                    sum += sequence[i];
+                }
+            }
+            sink = sum;
+        }));
+    }
+
+    static void BenchmarkTraversal() {
+        std::cout << "SegmentDeque traversal, 10000000 elements\n";
+
+        const int COUNT = 10000000;
+
+        SegmentDeque<int> deque(1024);
+        for (int i = 0; i < COUNT; i++) {
+            deque.Append(i);
+        }
+
+        Report("virtual Iterator<T>", MeasureMs([&]() {
+            long long sum = 0;
+            Iterator<int>* it = deque.GetIterator();
+            while (it->Next()) {
+                sum += it->Get();
+            }
+            delete it;
+            sink = sum;
+        }));
+
+        Report("range-for over static iterators", MeasureMs([&]() {
+            long long sum = 0;
+            for (int value : deque) {
+                sum += value;
+            }
+            sink = sum;
+        }));
+
+        Report("ForEach over segments", MeasureMs([&]() {
+            long long sum = 0;
+            deque.ForEach([&](int value) { sum += value; });
+            sink = sum;
+        }));
+
+        Report("Reduce", MeasureMs([&]() {
+            sink = deque.Reduce([](int acc, int x) { return acc + x; }, 0);
+        }));
+    }
+
+    static void BenchmarkReserve() {
+        std::cout << "SegmentDeque append of 10000000 elements, with and without ReserveBack\n";
+
+        const int COUNT = 10000000;
+
+        for (int reserved = 0; reserved < 2; reserved++) {
+            SegmentDeque<int> deque(256);
+            double reserve_ms = 0;
+
+            if (reserved) {
+                reserve_ms = MeasureMs([&]() { deque.ReserveBack(COUNT); });
+            }
+
+            double slowest_append_ms = 0;
+            double total_ms = MeasureMs([&]() {
+                for (int i = 0; i < COUNT; i++) {
+                    if (i % 256 == 0) {
+                        double append_ms = MeasureMs([&]() { deque.Append(i); });
+                        slowest_append_ms = append_ms > slowest_append_ms ? append_ms : slowest_append_ms;
+                    } else {
+                        deque.Append(i);
+                    }
+                }
+            });
+
+            std::string name = reserved ? "(reserved)" : "(no reserve)";
+            if (reserved) {
+                Report("ReserveBack", reserve_ms);
+            }
+            Report("Append " + name, total_ms);
+            Report("max segment-opening Append " + name, slowest_append_ms);
+        }
+    }
+
+    template <typename DequeType>
+    static double MeasureShortLivedDeques(int count, int size) {
+        return MeasureMs([&]() {
+            long long sum = 0;
+            for (int i = 0; i < count; i++) {
+                DequeType deque;
+                for (int j = 0; j < size; j++) {
+                    deque.Append(j);
+                }
+                sum += deque.Where([](int x) { return x % 2 == 0; }).GetSize();
+            }
+            sink = sum;
+        });
+    }
+
+    static void BenchmarkSmallDeques() {
+        std::cout << "1000000 short-lived deques of 20 elements, each filtered once\n";
+
+        const int COUNT = 1000000;
+        const int SIZE = 20;
+
+        Report("SegmentDeque<int> (inline storage)", MeasureShortLivedDeques<SegmentDeque<int>>(COUNT, SIZE));
+        Report("SegmentDeque<int, 0> (heap only)", MeasureShortLivedDeques<SegmentDeque<int, 0>>(COUNT, SIZE));
+    }
+
+    static void BenchmarkSort() {
+        std::cout << "Sorting 10000000 ints (" << std::thread::hardware_concurrency() << " hardware threads)\n";
+
+        const int COUNT = 10000000;
+
+        SegmentDeque<int> deque(1024);
+        unsigned int state = 1;
+        for (int i = 0; i < COUNT; i++) {
+            state = state * 1103515245u + 12345u;
+            deque.Append(static_cast<int>(state >> 1));
+        }
+        SegmentDeque<int> stable_copy(deque);
+        SegmentDeque<int> copy(deque);
+
+        Report("SegmentDeque::Sort", MeasureMs([&]() { deque.Sort(); }));
+        Report("SegmentDeque::StableSort", MeasureMs([&]() { stable_copy.StableSort(); }));
+        Report("copy out to std::vector, std::sort, copy back", MeasureMs([&]() {
+            std::vector<int> values;
+            values.reserve(copy.GetSize());
+            for (int value : copy) {
+                values.push_back(value);
+            }
+            std::sort(values.begin(), values.end());
+            copy.Clear();
+            for (int value : values) {
+                copy.Append(value);
+            }
+        }));
+    }
+
+    static void BenchmarkBinarySearch() {
+        std::cout << "1000000 lookups in a sorted deque of 10000000 timestamps\n";
+
+        const int COUNT = 10000000;
+        const int LOOKUPS = 1000000;
+
+        SegmentDeque<long long> deque(1024);
+        for (int i = 0; i < COUNT; i++) {
+            deque.Append(static_cast<long long>(i) * 3);
+        }
+
+        Report("binary search through Get(i)", MeasureMs([&]() {
+            long long sum = 0;
+            for (int i = 0; i < LOOKUPS; i++) {
+                long long key = (i * 7919LL) % (COUNT * 3LL);
+                size_t low = 0;
+                size_t high = deque.GetSize();
+
+                while (low < high) {
+                    size_t middle = low + (high - low) / 2;
+                    if (deque.Get(middle) < key) {
+                        low = middle + 1;
+                    } else {
+                        high = middle;
+                    }
+                }
+                sum += low;
+            }
+            sink = sum;
+        }));
+
+        Report("LowerBound over fence keys", MeasureMs([&]() {
+            long long sum = 0;
+            for (int i = 0; i < LOOKUPS; i++) {
+                sum += deque.LowerBound((i * 7919LL) % (COUNT * 3LL));
+            }
+            sink = sum;
+        }));
+    }
+
+    static void BenchmarkRangeReduce() {
+        std::cout << "100 sum/max queries over windows of 5000000 out of 10000000 elements\n";
+
+        const int COUNT = 10000000;
+        const int QUERIES = 100;
+        const size_t WINDOW = COUNT / 2;
+
+        SummarizedSegmentDeque<long long, StatsMonoid<long long>> deque(1024);
+        for (int i = 0; i < COUNT; i++) {
+            deque.Append(i % 1000);
+        }
+
+        Report("scan of the window", MeasureMs([&]() {
+            long long sum = 0;
+            const SegmentDeque<long long>& plain = deque.GetDeque();
+            for (int q = 0; q < QUERIES; q++) {
+                size_t begin = (q * 7919) % (COUNT - WINDOW);
+                long long max = 0;
+                for (size_t i = begin; i < begin + WINDOW; i++) {
+                    sum += plain[i];
+                    max = plain[i] > max ? plain[i] : max;
+                }
+                sum += max;
+            }
+            sink = sum;
+        }));
+
+        Report("RangeReduce over segment summaries", MeasureMs([&]() {
+            long long sum = 0;
+            for (int q = 0; q < QUERIES; q++) {
+                size_t begin = (q * 7919) % (COUNT - WINDOW);
+                Stats<long long> stats = deque.RangeReduce(begin, begin + WINDOW);
+                sum += stats.sum + stats.max;
+            }
+            sink = sum;
+        }));
+    }
+
+    static void BenchmarkSlidingWindow() {
+        std::cout << "Sliding window max of 1000 samples, queried after each of 1000000 steps\n";
+
+        const int STEPS = 1000000;
+        const size_t WINDOW = 1000;
+
+        Report("SegmentDeque + Reduce per step", MeasureMs([&]() {
+            SegmentDeque<int> deque;
+            long long sum = 0;
+            for (int i = 0; i < STEPS; i++) {
+                deque.Append(static_cast<int>((i * 7919LL) % 100003));
+                if (deque.GetSize() > WINDOW) {
+                    deque.PopFront();
+                }
+                sum += deque.Reduce([](int acc, int x) { return x > acc ? x : acc; }, 0);
+            }
+            sink = sum;
+        }));
+
+        Report("WindowedSegmentDeque<int, MaxMonoid>", MeasureMs([&]() {
+            WindowedSegmentDeque<int, MaxMonoid<int>> deque;
+            long long sum = 0;
+            for (int i = 0; i < STEPS; i++) {
+                deque.Append(static_cast<int>((i * 7919LL) % 100003));
+                if (deque.GetSize() > WINDOW) {
+                    deque.PopFront();
+                }
+                sum += deque.Aggregate();
+            }
+            sink = sum;
+        }));
+    }
+
+    static void BenchmarkLoadSave() {
+        std::cout << "Saving and loading 10000000 integers as text\n";
+
+        const int COUNT = 10000000;
+        const std::string path = "deque_benchmark.txt";
+
+        SegmentDeque<int> deque(1024);
+        for (int i = 0; i < COUNT; i++) {
+            deque.Append(static_cast<int>((i * 2654435761LL) % 2000000001 - 1000000000));
+        }
+
+        Report("DequeIO::SaveIntegers", MeasureMs([&]() { DequeIO::SaveIntegers(path, deque); }));
+
+        SegmentDeque<int> loaded(1024);
+        Report("DequeIO::LoadIntegers (mmap + from_chars)", MeasureMs([&]() { DequeIO::LoadIntegers(path, loaded); }));
+
+        SegmentDeque<int> streamed(1024);
+        Report("std::ifstream >> int + Append", MeasureMs([&]() {
+            std::ifstream input(path);
+            int value;
+            while (input >> value) {
+                streamed.Append(value);
+            }
+        }));
+
+        sink = loaded.GetSize() + streamed.GetSize();
+        std::remove(path.c_str());
+    }
+
+    static void BenchmarkWriteTo() {
+        std::cout << "Formatting 1000000 integers into a stream\n";
+
+        const int COUNT = 1000000;
+        SegmentDeque<int> deque(1024);
+        for (int i = 0; i < COUNT; i++) {
+            deque.Append(static_cast<int>((i * 2654435761LL) % 2000000001 - 1000000000));
+        }
+
+        std::ostringstream written;
+        Report("SegmentDeque::WriteTo", MeasureMs([&]() { deque.WriteTo(written); }));
+
+        std::ostringstream streamed;
+        Report("operator<< per element (iterator)", MeasureMs([&]() {
+            bool first = true;
+            for (int value : deque) {
+                if (!first) {
+                    streamed << ", ";
+                }
+                first = false;
+                streamed << value;
+            }
+        }));
+
+        sink = written.str().size() + streamed.str().size();
+    }
+
+    static void BenchmarkFlatMap() {
+        std::cout << "FlatMap of 1000000 elements into 4 outputs each\n";
+
+        const int COUNT = 1000000;
+        SegmentDeque<int> deque(1024);
+        for (int i = 0; i < COUNT; i++) {
+            deque.Append(i);
+        }
+
+        Report("per-element container + Append", MeasureMs([&]() {
+            SegmentDeque<int> result(1024);
+            deque.ForEach([&](const int& value) {
+                SegmentDeque<int> outputs;
+                for (int j = 0; j < 4; j++) {
+                    outputs.Append(value + j);
+                }
+                for (size_t j = 0; j < outputs.GetSize(); j++) {
+                    result.Append(outputs.Get(j));
+                }
+            });
+            sink = result.GetSize();
+        }));
+
+        Report("FlatMap<U> with Emitter", MeasureMs([&]() {
+            auto result = deque.FlatMap<int>([](int value, SegmentDeque<int>::Emitter& emit) {
+                for (int j = 0; j < 4; j++) {
+                    emit(value + j);
+                }
+            });
+            sink = result.GetSize();
+        }));
+
+        Report("FlatMap<U> with Emitter and size hint", MeasureMs([&]() {
+            auto result = deque.FlatMap<int>([](int value, SegmentDeque<int>::Emitter& emit) {
+                for (int j = 0; j < 4; j++) {
+                    emit(value + j);
+                }
+            }, [](int) { return 4; });
+            sink = result.GetSize();
+        }));
+    }
+
+    static void BenchmarkWhere() {
+        std::cout << "Filtering 10000000 random integers\n";
+
+        const int COUNT = 10000000;
+        SegmentDeque<int> deque(1024);
+        unsigned long long state = 1;
+        for (int i = 0; i < COUNT; i++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            deque.Append(static_cast<int>(state >> 32));
+        }
+
+        auto even = [](int x) { return x % 2 == 0; };
+        auto positive = [](int x) { return x > 0; };
+        auto rare = [](int x) { return x % 64 == 0; };
+
+        auto branching = [&](auto predicate) {
+            SegmentDeque<int> result(1024);
+            deque.ForEach([&](const int& value) {
+                if (predicate(value)) {
+                    result.Append(value);
+                }
+            });
+            sink = result.GetSize();
+        };
+
+        Report("Append if predicate (even)", MeasureMs([&]() { branching(even); }));
+        Report("Where, block compaction (even)", MeasureMs([&]() { sink = deque.Where(even).GetSize(); }));
+        Report("Append if predicate (positive)", MeasureMs([&]() { branching(positive); }));
+        Report("Where, block compaction (positive)", MeasureMs([&]() { sink = deque.Where(positive).GetSize(); }));
+        Report("Append if predicate (1 in 64)", MeasureMs([&]() { branching(rare); }));
+        Report("Where, block compaction (1 in 64)", MeasureMs([&]() { sink = deque.Where(rare).GetSize(); }));
+    }
+
+    static void BenchmarkInPlace() {
+        std::cout << "Copying vs in-place transformations of 10000000 integers\n";
+
+        const int COUNT = 10000000;
+        SegmentDeque<int> source(1024);
+        for (int i = 0; i < COUNT; i++) {
+            source.Append(i);
+        }
+
+        SegmentDeque<int> deque = source;
+        Report("deque = deque.Map(double)", MeasureMs([&]() { deque = deque.Map([](int x) { return x * 2; }); }));
+
+        deque = source;
+        Report("deque.Transform(double)", MeasureMs([&]() { deque.Transform([](int x) { return x * 2; }); }));
+
+        deque = source;
+        Report("deque = deque.Where(x % 3 == 0)", MeasureMs([&]() { deque = deque.Where([](int x) { return x % 3 == 0; }); }));
+
+        deque = source;
+        Report("deque.Retain(x % 3 == 0)", MeasureMs([&]() { deque.Retain([](int x) { return x % 3 == 0; }); }));
+
+        sink = deque.GetSize();
+    }
+
+    // producers threads append total values in batches of batch (1 means single Append) while
+    // consumers threads pop them the same way. With no consumers the calling thread appends
+    // everything and then pops it.
+    template <typename Queue>
+    static double RunProducersConsumers(Queue& queue, int producers, int consumers, int total, size_t batch) {
+        std::atomic<int> consumed(0);
+
+        auto produce = [&](int producer, int count) {
+            std::vector<int> values(batch);
+
+            for (int i = 0; i < count; i += static_cast<int>(batch)) {
+                size_t size = count - i < static_cast<int>(batch) ? count - i : batch;
+                if (batch == 1) {
+                    queue.Append(producer + i);
+                } else {
+                    for (size_t j = 0; j < size; j++) {
+                        values[j] = producer + i + static_cast<int>(j);
+                    }
+                    queue.Append(values.data(), size);
+                }
+            }
+        };
+
+        auto consume = [&]() {
+            std::vector<int> values(batch);
+            long long sum = 0;
+
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                size_t count = batch == 1 ? (queue.TryPopFront(values[0]) ? 1 : 0) : queue.PopFront(values.data(), batch);
+                if (count == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (size_t j = 0; j < count; j++) {
+                    sum += values[j];
+                }
+                consumed.fetch_add(static_cast<int>(count), std::memory_order_relaxed);
+            }
+
+            sink = sum;
+        };
+
+        return MeasureMs([&]() {
+            if (consumers == 0) {
+                produce(0, total);
+                consume();
+                return;
+            }
+
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; p++) {
+                threads.emplace_back(produce, p, total / producers + (p < total % producers ? 1 : 0));
+            }
+            for (int c = 0; c < consumers; c++) {
+                threads.emplace_back(consume);
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+        });
+    }
+
+    static void BenchmarkConcurrentQueue() {
+        const int TOTAL = 1 << 20;
+        std::cout << "Passing " << TOTAL << " integers from producers to consumers ("
+                  << std::thread::hardware_concurrency() << " hardware threads)\n";
+
+        for (int threads = 1; threads <= 32; threads *= 2) {
+            int producers = threads > 1 ? threads / 2 : 1;
+            int consumers = threads - producers;
+            std::string label = std::to_string(threads) + (threads > 1 ? " threads" : " thread");
+
+            for (size_t batch : {static_cast<size_t>(1), static_cast<size_t>(64)}) {
+                std::string suffix = batch == 1 ? "" : ", batch 64";
+
+                LockedStdDeque<int> locked;
+                Report("mutex + std::deque, " + label + suffix,
+                       RunProducersConsumers(locked, producers, consumers, TOTAL, batch));
+
+                ConcurrentSegmentDeque<int> concurrent;
+                Report("ConcurrentSegmentDeque, " + label + suffix,
+                       RunProducersConsumers(concurrent, producers, consumers, TOTAL, batch));
+            }
+        }
+    }
+
+    template <typename Queue>
+    static double RunBoundedQueue(Queue& queue, int producers, int consumers, int total) {
+        return MeasureMs([&]() {
+            std::vector<std::thread> threads;
+
+            for (int p = 0; p < producers; p++) {
+                threads.emplace_back([&, p]() {
+                    for (int i = p; i < total; i += producers) {
+                        queue.Push(i);
+                    }
+                });
+            }
+
+            for (int c = 0; c < consumers; c++) {
+                threads.emplace_back([&]() {
+                    long long sum = 0;
+                    int value;
+                    while (queue.Pop(value)) {
+                        sum += value;
+                    }
+                    sink = sum;
+                });
+            }
+
+            for (int p = 0; p < producers; p++) {
+                threads[p].join();
+            }
+            queue.Close();
+            for (int c = 0; c < consumers; c++) {
+                threads[producers + c].join();
+            }
+        });
+    }
+
+    static void BenchmarkBoundedQueue() {
+        const int TOTAL = 1 << 19;
+        std::cout << "Passing " << TOTAL << " integers through a bounded queue of 256\n";
+
+        for (int threads : {2, 8, 32}) {
+            std::string label = std::to_string(threads / 2) + " producers, " + std::to_string(threads / 2) + " consumers";
+
+            BroadcastBoundedQueue<int> broadcast(256);
+            Report("notify_all queue, " + label, RunBoundedQueue(broadcast, threads / 2, threads / 2, TOTAL));
+
+            BoundedSegmentQueue<int> bounded(256);
+            Report("BoundedSegmentQueue, " + label, RunBoundedQueue(bounded, threads / 2, threads / 2, TOTAL));
+        }
+    }
+
+    // AnonHugePages of the process in KiB, or -1 where /proc/self/smaps_rollup is unavailable.
+    // The growth while a deque is built shows whether its segments really got huge pages.
+    static long long ReadHugePagesKb() {
+        std::ifstream smaps("/proc/self/smaps_rollup");
+        std::string line;
+
+        while (std::getline(smaps, line)) {
+            if (line.compare(0, 14, "AnonHugePages:") == 0) {
+                return std::stoll(line.substr(14));
+            }
+        }
+
+        return -1;
+    }
+
+    template <typename T>
+    static void RunLayout(const std::string& name, const SegmentLayout& layout, int count, int lookups) {
+        long long huge_before = ReadHugePagesKb();
+        SegmentDeque<T, 0> deque(layout);
+
+        double build_ms = MeasureMs([&]() {
+            for (int i = 0; i < count; i++) {
+                deque.Append(static_cast<T>(i));
+            }
+        });
+
+        double scan_ms = MeasureMs([&]() {
+            long long sum = 0;
+            deque.ForEach([&](T value) { sum += value; });
+            sink = sum;
+        });
+
+        double random_ms = MeasureMs([&]() {
+            long long sum = 0;
+            unsigned long long state = 1;
+            for (int i = 0; i < lookups; i++) {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                sum += deque[static_cast<size_t>((state >> 33) % static_cast<unsigned long long>(count))];
+            }
+            sink = sum;
+        });
+
+        DequeMemoryUsage usage = deque.MemoryUsage();
+        std::cout << "  " << name << ": " << deque.GetSegmentCount() << " segments, "
+                  << usage.metadata_bytes / 1024 << " KiB metadata";
+        long long huge_after = ReadHugePagesKb();
+        if (huge_before >= 0 && huge_after > huge_before) {
+            std::cout << ", " << (huge_after - huge_before) / 1024 << " MiB on huge pages";
+        }
+        std::cout << "\n";
+
+        Report("    Append", build_ms);
+        Report("    ForEach sum", scan_ms);
+        Report("    random operator[]", random_ms);
+    }
+
+    static void BenchmarkSegmentLayout() {
+        const int COUNT = 1 << 25;
+        const int LOOKUPS = 1 << 24;
+        std::cout << "Segment layouts, " << COUNT << " ints, " << LOOKUPS << " random lookups\n";
+
+        RunLayout<int>("16 elements (default)", SegmentLayout::Elements(16), COUNT, LOOKUPS);
+        RunLayout<int>("1024 elements", SegmentLayout::Elements(1024), COUNT, LOOKUPS);
+        RunLayout<int>("4 KiB, page aligned", SegmentLayout::Bytes(4 << 10), COUNT, LOOKUPS);
+        RunLayout<int>("64 KiB, page aligned", SegmentLayout::Bytes(64 << 10), COUNT, LOOKUPS);
+        RunLayout<int>("2 MiB, no huge pages", SegmentLayout::Bytes(SegmentLayout::HUGE_PAGE_BYTES), COUNT, LOOKUPS);
+        RunLayout<int>("2 MiB, MADV_HUGEPAGE", SegmentLayout::Bytes(SegmentLayout::HUGE_PAGE_BYTES, true), COUNT, LOOKUPS);
+
+        std::cout << "Segment layouts, " << COUNT << " chars\n";
+        RunLayout<char>("16 elements (default)", SegmentLayout::Elements(16), COUNT, LOOKUPS);
+        RunLayout<char>("4 KiB, page aligned", SegmentLayout::Bytes(4 << 10), COUNT, LOOKUPS);
+    }
+};
+
+volatile long long Benchmarks::sink = 0;
+
+void RunDequeBenchmarks() {
+    Benchmarks::RunAllBenchmarks();
+}
+
+#endif
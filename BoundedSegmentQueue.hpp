@@ -0,0 +1,287 @@
+#ifndef BOUNDEDSEGMENTQUEUE_HPP
+#define BOUNDEDSEGMENTQUEUE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include "SegmentDeque.hpp"
+
+// Blocking FIFO that holds at most capacity elements. Producers wait for room and consumers
+// wait for elements on separate condition variables, and a push or pop wakes only as many
+// sleepers of the other side as it can satisfy. The segments of the full capacity are
+// allocated up front and emptied segments are kept as spares, so steady-state pushes and
+// pops do not allocate. After Close, pushes fail and pops drain what is left.
+template <typename T>
+class BoundedSegmentQueue {
+public:
+    explicit BoundedSegmentQueue(size_t capacity, size_t segment_capacity = 64);
+
+    BoundedSegmentQueue(const BoundedSegmentQueue&) = delete;
+    BoundedSegmentQueue& operator=(const BoundedSegmentQueue&) = delete;
+
+    // Waits for room; returns false if the queue is closed.
+    bool Push(const T& value);
+    // Returns false at once if the queue is full or closed.
+    bool TryPush(const T& value);
+    // Waits at most timeout for room; returns false on timeout or if the queue is closed.
+    template <typename Rep, typename Period>
+    bool PushFor(const T& value, const std::chrono::duration<Rep, Period>& timeout);
+
+    // Pushes all count values, waiting for room as needed; returns how many were pushed,
+    // which is less than count only if the queue was closed. Other producers may interleave
+    // between the parts that fit at a time.
+    size_t Push(const T* values, size_t count);
+    // Pushes as many of the values as fit right now.
+    size_t TryPush(const T* values, size_t count);
+
+    // Waits for an element; returns false once the queue is closed and empty.
+    bool Pop(T& value);
+    bool TryPop(T& value);
+    template <typename Rep, typename Period>
+    bool PopFor(T& value, const std::chrono::duration<Rep, Period>& timeout);
+
+    // Waits for at least one element, then pops up to max_count; returns 0 once the queue is
+    // closed and empty.
+    size_t Pop(T* output, size_t max_count);
+    size_t TryPop(T* output, size_t max_count);
+
+    void Close();
+    bool IsClosed() const;
+    size_t GetSize() const;
+    size_t GetCapacity() const;
+private:
+    // Threads blocked on one side. signaled counts those already notified that have not run
+    // yet, so a later push or pop does not spend another wakeup on them.
+    struct Waiters {
+        std::condition_variable condition;
+        size_t sleeping = 0;
+        size_t signaled = 0;
+    };
+
+    mutable std::mutex lock;
+    Waiters producers;
+    Waiters consumers;
+
+    SegmentDeque<T, 0> items;
+    size_t capacity;
+    bool closed;
+
+    // All of these are called with lock held.
+    size_t PushLocked(const T* values, size_t count);
+    size_t PopLocked(T* output, size_t max_count);
+
+    template <typename Ready>
+    static void Wait(std::unique_lock<std::mutex>& guard, Waiters& waiters, Ready ready);
+
+    template <typename Ready, typename Clock, typename Duration>
+    static bool WaitUntil(std::unique_lock<std::mutex>& guard, Waiters& waiters, Ready ready,
+                          const std::chrono::time_point<Clock, Duration>& deadline);
+
+    static void Wake(Waiters& waiters, size_t count);
+};
+
+template <typename T>
+BoundedSegmentQueue<T>::BoundedSegmentQueue(size_t capacity, size_t segment_capacity)
+    : items(segment_capacity), capacity(capacity), closed(false) {
+    if (capacity == 0) {
+        throw std::invalid_argument("capacity == 0");
+    }
+
+    // A full queue can straddle one more segment than capacity / segment_capacity.
+    items.SetSpareLimit(capacity / segment_capacity + 2);
+    items.ReserveBack(capacity);
+}
+
+template <typename T>
+template <typename Ready>
+void BoundedSegmentQueue<T>::Wait(std::unique_lock<std::mutex>& guard, Waiters& waiters, Ready ready) {
+    while (!ready()) {
+        waiters.sleeping++;
+        waiters.condition.wait(guard);
+        waiters.sleeping--;
+
+        if (waiters.signaled > 0) {
+            waiters.signaled--;
+        }
+    }
+}
+
+template <typename T>
+template <typename Ready, typename Clock, typename Duration>
+bool BoundedSegmentQueue<T>::WaitUntil(std::unique_lock<std::mutex>& guard, Waiters& waiters, Ready ready,
+                                       const std::chrono::time_point<Clock, Duration>& deadline) {
+    while (!ready()) {
+        waiters.sleeping++;
+        std::cv_status status = waiters.condition.wait_until(guard, deadline);
+        waiters.sleeping--;
+
+        if (waiters.signaled > 0) {
+            waiters.signaled--;
+        }
+
+        if (status == std::cv_status::timeout) {
+            return ready();
+        }
+    }
+
+    return true;
+}
+
+// Notifies one sleeper per element that became available (or per freed slot), skipping
+// sleepers that are already on their way. A thread woken spuriously or by a timeout may
+// absorb a notification, but it rechecks the queue itself before sleeping again.
+template <typename T>
+void BoundedSegmentQueue<T>::Wake(Waiters& waiters, size_t count) {
+    size_t idle = waiters.sleeping - waiters.signaled;
+    size_t woken = count < idle ? count : idle;
+
+    waiters.signaled += woken;
+
+    if (woken == idle && woken > 0) {
+        waiters.condition.notify_all();
+        return;
+    }
+
+    for (size_t i = 0; i < woken; i++) {
+        waiters.condition.notify_one();
+    }
+}
+
+template <typename T>
+size_t BoundedSegmentQueue<T>::PushLocked(const T* values, size_t count) {
+    size_t room = capacity - items.GetSize();
+    size_t pushed = count < room ? count : room;
+
+    for (size_t i = 0; i < pushed; i++) {
+        items.Append(values[i]);
+    }
+
+    Wake(consumers, pushed);
+    return pushed;
+}
+
+template <typename T>
+size_t BoundedSegmentQueue<T>::PopLocked(T* output, size_t max_count) {
+    size_t popped = items.DrainFront(output, max_count);
+
+    Wake(producers, popped);
+    return popped;
+}
+
+template <typename T>
+bool BoundedSegmentQueue<T>::Push(const T& value) {
+    return Push(&value, 1) == 1;
+}
+
+template <typename T>
+bool BoundedSegmentQueue<T>::TryPush(const T& value) {
+    return TryPush(&value, 1) == 1;
+}
+
+template <typename T>
+template <typename Rep, typename Period>
+bool BoundedSegmentQueue<T>::PushFor(const T& value, const std::chrono::duration<Rep, Period>& timeout) {
+    std::unique_lock<std::mutex> guard(lock);
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    if (!WaitUntil(guard, producers, [&]() { return closed || items.GetSize() < capacity; }, deadline) || closed) {
+        return false;
+    }
+
+    return PushLocked(&value, 1) == 1;
+}
+
+template <typename T>
+size_t BoundedSegmentQueue<T>::Push(const T* values, size_t count) {
+    std::unique_lock<std::mutex> guard(lock);
+    size_t pushed = 0;
+
+    while (pushed < count) {
+        Wait(guard, producers, [&]() { return closed || items.GetSize() < capacity; });
+
+        if (closed) {
+            break;
+        }
+
+        pushed += PushLocked(values + pushed, count - pushed);
+    }
+
+    return pushed;
+}
+
+template <typename T>
+size_t BoundedSegmentQueue<T>::TryPush(const T* values, size_t count) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    return closed ? 0 : PushLocked(values, count);
+}
+
+template <typename T>
+bool BoundedSegmentQueue<T>::Pop(T& value) {
+    return Pop(&value, 1) == 1;
+}
+
+template <typename T>
+bool BoundedSegmentQueue<T>::TryPop(T& value) {
+    return TryPop(&value, 1) == 1;
+}
+
+template <typename T>
+template <typename Rep, typename Period>
+bool BoundedSegmentQueue<T>::PopFor(T& value, const std::chrono::duration<Rep, Period>& timeout) {
+    std::unique_lock<std::mutex> guard(lock);
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    WaitUntil(guard, consumers, [&]() { return closed || !items.IsEmpty(); }, deadline);
+
+    return PopLocked(&value, 1) == 1;
+}
+
+template <typename T>
+size_t BoundedSegmentQueue<T>::Pop(T* output, size_t max_count) {
+    if (max_count == 0) {
+        return 0;
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    Wait(guard, consumers, [&]() { return closed || !items.IsEmpty(); });
+    return PopLocked(output, max_count);
+}
+
+template <typename T>
+size_t BoundedSegmentQueue<T>::TryPop(T* output, size_t max_count) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    return PopLocked(output, max_count);
+}
+
+template <typename T>
+void BoundedSegmentQueue<T>::Close() {
+    std::lock_guard<std::mutex> guard(lock);
+
+    closed = true;
+    producers.condition.notify_all();
+    consumers.condition.notify_all();
+}
+
+template <typename T>
+bool BoundedSegmentQueue<T>::IsClosed() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return closed;
+}
+
+template <typename T>
+size_t BoundedSegmentQueue<T>::GetSize() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return items.GetSize();
+}
+
+template <typename T>
+size_t BoundedSegmentQueue<T>::GetCapacity() const {
+    return capacity;
+}
+
+#endif
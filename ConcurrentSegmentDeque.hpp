@@ -0,0 +1,227 @@
+#ifndef CONCURRENTSEGMENTDEQUE_HPP
+#define CONCURRENTSEGMENTDEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+// Multi-producer multi-consumer FIFO in the two-lock queue style: producers append under
+// tail_lock and consumers pop under head_lock, so the two ends never wait for each other.
+// Elements live in a linked list of fixed-size segments. A producer publishes a slot by
+// storing the segment's new published count with release order, and a consumer reads only
+// slots below the count it loaded with acquire order. A consumer that leaves an exhausted
+// segment hands it to producers through a single spare slot instead of freeing it.
+template <typename T>
+class ConcurrentSegmentDeque {
+public:
+    explicit ConcurrentSegmentDeque(size_t segment_capacity = 256);
+    ~ConcurrentSegmentDeque();
+
+    ConcurrentSegmentDeque(const ConcurrentSegmentDeque&) = delete;
+    ConcurrentSegmentDeque& operator=(const ConcurrentSegmentDeque&) = delete;
+
+    void Append(const T& value);
+    void Append(T&& value);
+
+    // Appends count values taking tail_lock once.
+    void Append(const T* values, size_t count);
+
+    // Pops the first element into value; returns false if the deque is empty.
+    bool TryPopFront(T& value);
+
+    // Pops up to max_count elements into output taking head_lock once; returns the number popped.
+    size_t PopFront(T* output, size_t max_count);
+
+    // Lock-free, and exact only when no other thread is appending or popping.
+    size_t GetSize() const;
+    bool IsEmpty() const;
+    size_t GetSegmentCapacity() const;
+private:
+    struct Segment {
+        T* items;
+        std::atomic<size_t> published;
+        std::atomic<Segment*> next;
+
+        explicit Segment(size_t capacity) : items(new T[capacity]()), published(0), next(nullptr) {}
+        ~Segment() { delete[] items; }
+    };
+
+    static const size_t CACHE_LINE = 64;
+
+    const size_t segment_capacity;
+
+    alignas(CACHE_LINE) std::mutex head_lock;
+    Segment* head;
+    size_t head_position;
+    std::atomic<size_t> popped;
+
+    alignas(CACHE_LINE) std::mutex tail_lock;
+    Segment* tail;
+    std::atomic<size_t> pushed;
+
+    alignas(CACHE_LINE) std::atomic<Segment*> spare;
+
+    // Both are called with the corresponding lock held.
+    Segment* PrepareTail();
+    bool PrepareHead();
+};
+
+template <typename T>
+ConcurrentSegmentDeque<T>::ConcurrentSegmentDeque(size_t segment_capacity)
+    : segment_capacity(segment_capacity), head(nullptr), head_position(0), popped(0),
+      tail(nullptr), pushed(0), spare(nullptr) {
+    if (segment_capacity == 0) {
+        throw std::invalid_argument("segment_capacity == 0");
+    }
+
+    head = tail = new Segment(segment_capacity);
+}
+
+template <typename T>
+ConcurrentSegmentDeque<T>::~ConcurrentSegmentDeque() {
+    while (head) {
+        Segment* next = head->next.load(std::memory_order_relaxed);
+        delete head;
+        head = next;
+    }
+
+    delete spare.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+typename ConcurrentSegmentDeque<T>::Segment* ConcurrentSegmentDeque<T>::PrepareTail() {
+    if (tail->published.load(std::memory_order_relaxed) < segment_capacity) {
+        return tail;
+    }
+
+    Segment* segment = spare.exchange(nullptr, std::memory_order_acq_rel);
+
+    if (segment) {
+        segment->published.store(0, std::memory_order_relaxed);
+        segment->next.store(nullptr, std::memory_order_relaxed);
+    } else {
+        segment = new Segment(segment_capacity);
+    }
+
+    tail->next.store(segment, std::memory_order_release);
+    tail = segment;
+    return tail;
+}
+
+template <typename T>
+bool ConcurrentSegmentDeque<T>::PrepareHead() {
+    if (head_position == segment_capacity) {
+        Segment* next = head->next.load(std::memory_order_acquire);
+
+        if (!next) {
+            return false;
+        }
+
+        Segment* retired = head;
+        head = next;
+        head_position = 0;
+
+        delete spare.exchange(retired, std::memory_order_acq_rel);
+    }
+
+    return head_position < head->published.load(std::memory_order_acquire);
+}
+
+template <typename T>
+void ConcurrentSegmentDeque<T>::Append(const T& value) {
+    T copy(value);
+    Append(std::move(copy));
+}
+
+template <typename T>
+void ConcurrentSegmentDeque<T>::Append(T&& value) {
+    std::lock_guard<std::mutex> guard(tail_lock);
+
+    Segment* segment = PrepareTail();
+    size_t position = segment->published.load(std::memory_order_relaxed);
+
+    segment->items[position] = std::move(value);
+    pushed.store(pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    segment->published.store(position + 1, std::memory_order_release);
+}
+
+template <typename T>
+void ConcurrentSegmentDeque<T>::Append(const T* values, size_t count) {
+    std::lock_guard<std::mutex> guard(tail_lock);
+
+    size_t appended = 0;
+
+    while (appended < count) {
+        Segment* segment = PrepareTail();
+        size_t position = segment->published.load(std::memory_order_relaxed);
+        size_t room = segment_capacity - position;
+        size_t copied = count - appended < room ? count - appended : room;
+
+        for (size_t i = 0; i < copied; i++) {
+            segment->items[position + i] = values[appended + i];
+        }
+
+        pushed.store(pushed.load(std::memory_order_relaxed) + copied, std::memory_order_relaxed);
+        segment->published.store(position + copied, std::memory_order_release);
+        appended += copied;
+    }
+}
+
+template <typename T>
+bool ConcurrentSegmentDeque<T>::TryPopFront(T& value) {
+    std::lock_guard<std::mutex> guard(head_lock);
+
+    if (!PrepareHead()) {
+        return false;
+    }
+
+    value = std::move(head->items[head_position++]);
+    popped.store(popped.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t ConcurrentSegmentDeque<T>::PopFront(T* output, size_t max_count) {
+    std::lock_guard<std::mutex> guard(head_lock);
+
+    size_t count = 0;
+
+    while (count < max_count && PrepareHead()) {
+        size_t available = head->published.load(std::memory_order_acquire) - head_position;
+        size_t taken = max_count - count < available ? max_count - count : available;
+
+        for (size_t i = 0; i < taken; i++) {
+            output[count + i] = std::move(head->items[head_position + i]);
+        }
+
+        head_position += taken;
+        count += taken;
+    }
+
+    popped.store(popped.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    return count;
+}
+
+template <typename T>
+size_t ConcurrentSegmentDeque<T>::GetSize() const {
+    // pushed is advanced before a slot is published and popped after it is read, so popped
+    // never exceeds pushed and reading popped first keeps the difference non-negative.
+    size_t removed = popped.load(std::memory_order_acquire);
+    size_t added = pushed.load(std::memory_order_acquire);
+
+    return added - removed;
+}
+
+template <typename T>
+bool ConcurrentSegmentDeque<T>::IsEmpty() const {
+    return GetSize() == 0;
+}
+
+template <typename T>
+size_t ConcurrentSegmentDeque<T>::GetSegmentCapacity() const {
+    return segment_capacity;
+}
+
+#endif
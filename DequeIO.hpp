@@ -0,0 +1,208 @@
+#ifndef DEQUEIO_HPP
+#define DEQUEIO_HPP
+
+#include <charconv>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "SegmentDeque.hpp"
+#include "lib/BufferedWriter.hpp"
+#include "lib/MappedFile.hpp"
+
+// Bulk text I/O of integer deques. Numbers are separated by whitespace or commas.
+class DequeIO {
+public:
+    // Replaces the contents of deque with the integers in the file and returns their count.
+    // Files larger than PARALLEL_CHUNK_BYTES are parsed in chunks on up to thread_count
+    // threads (0 means hardware_concurrency()): the threads first count the numbers of their
+    // chunks, the deque is sized once, and then every thread parses into its own index range.
+    template <typename T, size_t InlineCapacity>
+    static size_t LoadIntegers(const std::string& path, SegmentDeque<T, InlineCapacity>& deque, size_t thread_count = 0);
+
+    // Writes one integer per line and returns the count.
+    template <typename T, size_t InlineCapacity>
+    static size_t SaveIntegers(const std::string& path, const SegmentDeque<T, InlineCapacity>& deque);
+
+    static const size_t PARALLEL_CHUNK_BYTES = 1 << 22;
+private:
+    static bool IsSeparator(char symbol) {
+        return symbol == ' ' || symbol == '\n' || symbol == '\r' || symbol == '\t' || symbol == ',';
+    }
+
+    // Number of maximal runs of non-separators in [begin, end). Every run that Parse accepts
+    // is one number, so on success this is the count Parse will emit.
+    static size_t CountTokens(const char* begin, const char* end) {
+        size_t count = 0;
+        bool previous_separator = true;
+
+        for (const char* position = begin; position < end; position++) {
+            bool separator = IsSeparator(*position);
+            count += previous_separator && !separator ? 1 : 0;
+            previous_separator = separator;
+        }
+
+        return count;
+    }
+
+    // Calls func(index) for every chunk, chunk 0 on the calling thread, and rethrows the first
+    // exception by chunk order once all of them have finished.
+    template <typename Func>
+    static void RunChunks(size_t chunk_count, Func func);
+
+    // Parses [begin, end) and passes every number to emit. offset is the position of begin in
+    // the file, for error messages.
+    template <typename T, typename Emit>
+    static void Parse(const char* begin, const char* end, size_t offset, Emit emit);
+};
+
+template <typename T, typename Emit>
+void DequeIO::Parse(const char* begin, const char* end, size_t offset, Emit emit) {
+    const char* position = begin;
+
+    while (true) {
+        while (position < end && IsSeparator(*position)) {
+            position++;
+        }
+
+        if (position == end) {
+            return;
+        }
+
+        T value;
+        std::from_chars_result result = std::from_chars(position, end, value);
+
+        if (result.ec == std::errc::result_out_of_range) {
+            throw std::out_of_range("Number out of range at offset " + std::to_string(offset + (position - begin)));
+        }
+
+        if (result.ec != std::errc() || (result.ptr < end && !IsSeparator(*result.ptr))) {
+            throw std::invalid_argument("Invalid number at offset " + std::to_string(offset + (position - begin)));
+        }
+
+        emit(value);
+        position = result.ptr;
+    }
+}
+
+template <typename Func>
+void DequeIO::RunChunks(size_t chunk_count, Func func) {
+    std::vector<std::exception_ptr> errors(chunk_count);
+
+    auto run = [&](size_t index) {
+        try {
+            func(index);
+        } catch (...) {
+            errors[index] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunk_count; i++) {
+        workers.emplace_back(run, i);
+    }
+    run(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+template <typename T, size_t InlineCapacity>
+size_t DequeIO::LoadIntegers(const std::string& path, SegmentDeque<T, InlineCapacity>& deque, size_t thread_count) {
+    static_assert(std::is_integral<T>::value, "LoadIntegers needs an integral element type");
+
+    MappedFile file(path);
+    const char* data = file.GetData();
+    size_t size = file.GetSize();
+
+    size_t chunk_count = thread_count > 0 ? thread_count : std::thread::hardware_concurrency();
+    if (thread_count == 0 && size / PARALLEL_CHUNK_BYTES < chunk_count) {
+        chunk_count = size / PARALLEL_CHUNK_BYTES;
+    }
+    chunk_count = chunk_count > 0 ? chunk_count : 1;
+
+    // Parse into a fresh deque so that a malformed file leaves the target untouched.
+    SegmentDeque<T, InlineCapacity> result(deque.GetSegmentLayout());
+
+    if (chunk_count == 1) {
+        Parse<T>(data, data + size, 0, [&](T value) { result.Append(value); });
+        deque = std::move(result);
+        return deque.GetSize();
+    }
+
+    // Chunk boundaries are moved forward to the next separator so no number is split.
+    std::vector<size_t> bounds(chunk_count + 1, size);
+    bounds[0] = 0;
+
+    for (size_t i = 1; i < chunk_count; i++) {
+        size_t bound = size / chunk_count * i;
+        bound = bound > bounds[i - 1] ? bound : bounds[i - 1];
+
+        while (bound < size && !IsSeparator(data[bound])) {
+            bound++;
+        }
+
+        bounds[i] = bound;
+    }
+
+    // First pass: count the numbers of every chunk, so the result can be sized once and every
+    // chunk knows the index its first number goes to.
+    std::vector<size_t> starts(chunk_count + 1, 0);
+
+    RunChunks(chunk_count, [&](size_t index) {
+        starts[index + 1] = CountTokens(data + bounds[index], data + bounds[index + 1]);
+    });
+
+    for (size_t i = 0; i < chunk_count; i++) {
+        starts[i + 1] += starts[i];
+    }
+
+    result.Resize(starts[chunk_count]);
+
+    // Second pass: every chunk parses straight into its own range of segments.
+    RunChunks(chunk_count, [&](size_t index) {
+        if (starts[index] == starts[index + 1]) {
+            return;
+        }
+
+        size_t segment = result.GetSegmentIndex(starts[index]);
+        size_t position = starts[index] - result.GetSegmentStart(segment);
+        Segment<T>* current = result.GetSegment(segment);
+
+        Parse<T>(data + bounds[index], data + bounds[index + 1], bounds[index], [&](T value) {
+            if (position == current->GetEffectiveSize()) {
+                current = result.GetSegment(++segment);
+                position = 0;
+            }
+            (*current)[position++] = value;
+        });
+    });
+
+    deque = std::move(result);
+    return deque.GetSize();
+}
+
+template <typename T, size_t InlineCapacity>
+size_t DequeIO::SaveIntegers(const std::string& path, const SegmentDeque<T, InlineCapacity>& deque) {
+    static_assert(std::is_integral<T>::value, "SaveIntegers needs an integral element type");
+
+    BufferedWriter writer(path);
+
+    deque.ForEach([&](const T& value) {
+        writer.WriteInteger(value);
+        writer.Write('\n');
+    });
+
+    writer.Close();
+    return deque.GetSize();
+}
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef ITERABLE_HPP
 #define ITERABLE_HPP
 
+#include <cstddef>
+#include <stdexcept>
+
 template <typename T>
 class Iterator {
 public:
@@ -19,4 +22,69 @@ public:
     virtual Iterator<T>* GetIterator() const = 0;
 };
 
-#endif
\ No newline at end of file
+// Compile-time counterpart of Iterable. Derived provides begin()/end() with plain iterators;
+// Derived may also hide ForEach with a faster traversal, which the algorithms below pick up.
+template <typename Derived, typename T>
+class StaticIterable {
+public:
+    template <typename Func>
+    void ForEach(Func func) {
+        for (T& value : Self()) {
+            func(value);
+        }
+    }
+
+    template <typename Func>
+    void ForEach(Func func) const {
+        for (const T& value : Self()) {
+            func(value);
+        }
+    }
+
+    template <typename Func>
+    size_t CountIf(Func predicate) const {
+        size_t count = 0;
+        Self().ForEach([&](const T& value) { count += predicate(value) ? 1 : 0; });
+        return count;
+    }
+protected:
+    Derived& Self() {
+        return static_cast<Derived&>(*this);
+    }
+
+    const Derived& Self() const {
+        return static_cast<const Derived&>(*this);
+    }
+};
+
+// Thin virtual Iterator over a pair of static iterators, for callers of the Iterable interface.
+template <typename StaticIterator, typename T>
+class IteratorAdapter : public Iterator<T> {
+public:
+    IteratorAdapter(StaticIterator begin, StaticIterator end) : current(begin), end(end), started(false) {}
+
+    bool Next() override {
+        if (!started) {
+            started = true;
+        } else if (current != end) {
+            ++current;
+        }
+
+        return current != end;
+    }
+
+    T& Get() override {
+        if (!started || current == end) {
+            throw std::out_of_range("Iterator out of range");
+        }
+
+        return const_cast<T&>(*current);
+    }
+
+private:
+    StaticIterator current;
+    StaticIterator end;
+    bool started;
+};
+
+#endif
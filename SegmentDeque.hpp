@@ -1,452 +1,2008 @@
 #ifndef SEGMENTDEQUE_HPP
 #define SEGMENTDEQUE_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "lib/Sequence.hpp"
 #include "lib/ArraySequence.hpp"
 #include "lib/ListSequence.hpp"
+#include "lib/StaticSequence.hpp"
+#include "lib/RingBuffer.hpp"
+#include "lib/StreamCompaction.hpp"
+#include "lib/BufferedWriter.hpp"
 #include "Iterable.hpp"
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// How a SegmentDeque allocates its heap segments. Elements(n) gives segments of n elements in
+// plain new[] storage. Bytes(b) fits as many elements as a b-byte target allows (at least one)
+// and aligns the storage to a cache line, or to a page once a segment spans one. With
+// huge_pages, segments of at least HUGE_PAGE_BYTES are aligned to a huge page and passed to
+// madvise(MADV_HUGEPAGE) so transparent huge pages can back them; elsewhere than Linux, and
+// for smaller segments, the flag has no effect.
+struct SegmentLayout {
+    static const size_t CACHE_LINE_BYTES = 64;
+    static const size_t PAGE_BYTES = 4096;
+    static const size_t HUGE_PAGE_BYTES = 2 << 20;
+
+    size_t capacity;
+    size_t bytes;
+    size_t alignment;
+    bool huge_pages;
+
+    static SegmentLayout Elements(size_t capacity) {
+        return SegmentLayout{capacity, 0, 0, false};
+    }
+
+    static SegmentLayout Bytes(size_t bytes, bool huge_pages = false) {
+        size_t alignment = CACHE_LINE_BYTES;
+
+        if (huge_pages && bytes >= HUGE_PAGE_BYTES) {
+            alignment = HUGE_PAGE_BYTES;
+        } else if (bytes >= PAGE_BYTES) {
+            alignment = PAGE_BYTES;
+        }
+
+        return SegmentLayout{0, bytes, alignment, huge_pages};
+    }
+
+    // Elements per segment for element type T.
+    template <typename T>
+    size_t GetCapacity() const {
+        if (bytes == 0) {
+            return capacity;
+        }
+
+        return bytes / sizeof(T) > 0 ? bytes / sizeof(T) : 1;
+    }
+};
+
 template <typename T>
-struct Segment {
-    MutableArraySequence<T>* data;
+struct SegmentBlock;
+
+// A segment only describes its storage: how the items were allocated (alignment, shared block)
+// is deque-level layout, so the owning SegmentDeque allocates and frees them.
+template <typename T>
+struct Segment : public StaticSequence<Segment<T>, T> {
+    T* items;
+    size_t capacity;
     size_t front_offset;
     size_t back_size;
+    Segment<T>* next_spare;
+    // Shared allocation items point into, or nullptr if the segment has storage of its own.
+    SegmentBlock<T>* block;
 
-    Segment(MutableArraySequence<T>* arr) : data(arr), front_offset(0), back_size(0) {}
+    Segment(T* items, size_t capacity, SegmentBlock<T>* block = nullptr)
+        : items(items), capacity(capacity), front_offset(0), back_size(0), next_spare(nullptr), block(block) {}
 
-    ~Segment() {
-        delete data;
-    }
+    Segment(const Segment<T>&) = delete;
+    Segment& operator=(const Segment<T>&) = delete;
 
     size_t GetEffectiveSize() const {
         return back_size - front_offset;
     }
 
+    size_t GetSize() const {
+        return back_size - front_offset;
+    }
+
     bool IsEmpty() const {
         return front_offset >= back_size;
     }
 
     T& Get(size_t index) {
-        return data->Get(front_offset + index);
+        return items[front_offset + index];
     }
 
     const T& Get(size_t index) const {
-        return data->Get(front_offset + index);
+        return items[front_offset + index];
+    }
+
+    T& operator[](size_t index) {
+        return items[front_offset + index];
+    }
+
+    const T& operator[](size_t index) const {
+        return items[front_offset + index];
+    }
+
+    // The huge page advice must come before the elements are constructed, while no page of
+    // the storage has been touched yet. It is only a hint, so a failing madvise is ignored.
+    static T* AllocateItems(size_t capacity, size_t alignment, bool huge_pages) {
+        size_t bytes = capacity * sizeof(T);
+        T* storage = static_cast<T*>(::operator new(bytes, std::align_val_t(alignment)));
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (huge_pages && bytes >= SegmentLayout::HUGE_PAGE_BYTES && alignment % SegmentLayout::HUGE_PAGE_BYTES == 0) {
+            madvise(storage, bytes - bytes % SegmentLayout::HUGE_PAGE_BYTES, MADV_HUGEPAGE);
+        }
+#else
+        (void)huge_pages;
+#endif
+
+        try {
+            std::uninitialized_value_construct_n(storage, capacity);
+        } catch (...) {
+            ::operator delete(storage, std::align_val_t(alignment));
+            throw;
+        }
+
+        return storage;
+    }
+};
+
+// One allocation shared by several segments that Reserve creates at once. Every segment carved
+// from it holds a reference, and the storage is freed when the last of them is deleted.
+template <typename T>
+struct SegmentBlock {
+    T* items;
+    size_t count;
+    size_t alignment;
+    std::atomic<size_t> references;
+
+    SegmentBlock(size_t count, size_t alignment, bool huge_pages)
+        : items(alignment == 0 ? new T[count]() : Segment<T>::AllocateItems(count, alignment, huge_pages)), count(count),
+          alignment(alignment), references(0) {}
+
+    SegmentBlock(const SegmentBlock<T>&) = delete;
+    SegmentBlock& operator=(const SegmentBlock<T>&) = delete;
+
+    ~SegmentBlock() {
+        if (alignment == 0) {
+            delete[] items;
+        } else {
+            std::destroy_n(items, count);
+            ::operator delete(items, std::align_val_t(alignment));
+        }
     }
 };
 
+// Elements a SegmentDeque keeps inside the object before its first heap segment:
+// 32 for small types, fewer for large ones so the deque object stays within 512 bytes of storage.
+template <typename T>
+constexpr size_t DefaultInlineCapacity() {
+    return sizeof(T) * 32 <= 512 ? 32 : 512 / sizeof(T);
+}
+
+// Elements per heap segment when none are given: 512 bytes worth, and at least 16, so the
+// Segment header and the directory slot stay small next to the payload.
 template <typename T>
-class SegmentDeque {
+constexpr size_t DefaultSegmentCapacity() {
+    return sizeof(T) * 16 >= 512 ? 16 : 512 / sizeof(T);
+}
+
+template <typename T, size_t Capacity>
+struct InlineStorage {
+    T items[Capacity];
+
+    T* Data() {
+        return items;
+    }
+};
+
+template <typename T>
+struct InlineStorage<T, 0> {
+    T* Data() {
+        return nullptr;
+    }
+};
+
+// Memory held by a SegmentDeque, in bytes requested from the allocator (allocator overhead
+// not included). payload is the live elements; slack is element slots that hold nothing: dead
+// slots before front_offset, unused ones after back_size, spare segments and an unused inline
+// buffer; metadata is everything else: the deque object, heap Segment headers and the directory.
+struct DequeMemoryUsage {
+    static const size_t FILL_BUCKETS = 4;
+
+    size_t payload_bytes = 0;
+    size_t slack_bytes = 0;
+    size_t metadata_bytes = 0;
+
+    // Segments in the directory by effective size / capacity: bucket i counts fills in
+    // [i / FILL_BUCKETS, (i + 1) / FILL_BUCKETS), with full segments in the last bucket.
+    size_t fill_histogram[FILL_BUCKETS] = {};
+
+    size_t GetTotalBytes() const {
+        return payload_bytes + slack_bytes + metadata_bytes;
+    }
+};
+
+// Deque of fixed-size segments kept in a ring directory. Until it outgrows InlineCapacity
+// elements the deque lives in a single segment over its own inline buffer and does not touch
+// the heap; after that the elements spill into heap segments of segment_capacity each.
+template <typename T, size_t InlineCapacity = DefaultInlineCapacity<T>()>
+class SegmentDeque : public StaticIterable<SegmentDeque<T, InlineCapacity>, T> {
 public:
-    explicit SegmentDeque(size_t segment_capacity = 16);
+    explicit SegmentDeque(size_t segment_capacity = DefaultSegmentCapacity<T>());
+    explicit SegmentDeque(const SegmentLayout& layout);
+    SegmentDeque(const SegmentDeque<T, InlineCapacity>& deque);
+    SegmentDeque(SegmentDeque<T, InlineCapacity>&& deque);
     ~SegmentDeque();
 
+    SegmentDeque& operator=(const SegmentDeque<T, InlineCapacity>& deque);
+    SegmentDeque& operator=(SegmentDeque<T, InlineCapacity>&& deque);
+
     void Append(const T& value);
     void Prepend(const T& value);
     void PopBack();
     void PopFront();
+    void PopBack(size_t count);
+    void PopFront(size_t count);
+
+    // Removes all elements and returns the deque to its inline segment. Emptied heap segments
+    // are kept as spares up to the limit set by SetSpareLimit and freed beyond it.
+    void Clear();
+
+    // Grows the deque to size with value-initialized elements at the back, reserving all the
+    // new segments first, or shrinks it with PopBack. Lets callers fill a known number of
+    // elements in place, e.g. from several threads writing disjoint index ranges.
+    void Resize(size_t size);
+
+    template <typename OutputIt>
+    size_t DrainFront(OutputIt out, size_t count);
 
     T& Get(size_t index);
     const T& Get(size_t index) const;
+    T& At(size_t index);
+    const T& At(size_t index) const;
+
+    // Bounds are checked only in debug builds (without NDEBUG); Get() and At() always check.
+    T& operator[](size_t index);
+    const T& operator[](size_t index) const;
 
     size_t GetSize() const;
     bool IsEmpty() const;
+    bool IsInline() const;
+
+    // Binary search for deques kept sorted by compare: first over the fence keys (the first
+    // element of every segment), then inside one segment. Results are element indices.
+    size_t LowerBound(const T& value) const;
+    size_t UpperBound(const T& value) const;
+    std::pair<size_t, size_t> EqualRange(const T& value) const;
+
+    template <typename Compare>
+    size_t LowerBound(const T& value, Compare compare) const;
+
+    template <typename Compare>
+    size_t UpperBound(const T& value, Compare compare) const;
+
+    template <typename Compare>
+    std::pair<size_t, size_t> EqualRange(const T& value, Compare compare) const;
+
+    // Pre-allocates segments so that the next front_count Prepends and back_count Appends
+    // do not allocate. Both counts are covered together by one pool of spare segments, and the
+    // segments added by one call share a single allocation when the layout allows it.
+    void Reserve(size_t front_count, size_t back_count);
+    void ReserveFront(size_t count);
+    void ReserveBack(size_t count);
+    size_t GetSpareSegmentCount() const;
+
+    // Pops keep up to limit emptied heap segments as spares instead of freeing them, so a
+    // deque used as a queue stops allocating once it reaches its working size. Defaults to 0.
+    void SetSpareLimit(size_t limit);
 
     size_t GetSegmentCount() const;
+    size_t GetSegmentCapacity() const;
+    // The layout of this deque's heap segments; copies and the results of Where, Map and
+    // FlatMap are built from it. For another element type a byte target gives a new element
+    // count with the same alignment and huge page advice; a layout given in elements keeps
+    // its element count.
+    SegmentLayout GetSegmentLayout() const;
     const Segment<T>* GetSegment(size_t index) const;
     Segment<T>* GetSegment(size_t index);
 
+    // Index of the segment holding element index, and index of the first element of a segment.
+    size_t GetSegmentIndex(size_t index) const;
+    size_t GetSegmentStart(size_t segment) const;
+
+    // Walks the directory and the spare pool; O(segment count).
+    DequeMemoryUsage MemoryUsage() const;
+
     template <typename Func>
     auto Map(Func func) const -> SegmentDeque<decltype(func(std::declval<T>()))>;
 
     template <typename Func>
     auto FlatMap(Func func) const -> SegmentDeque<typename decltype(func(std::declval<T>()))::value_type>;
 
+    // Appends to the back of a deque through a cached pointer to its last segment, so an
+    // element costs one capacity check and a store. The deque must not be changed by other
+    // means while the emitter is in use.
+    class Emitter {
+    public:
+        explicit Emitter(SegmentDeque& deque)
+            : deque(&deque), tail(deque.segments[deque.segments.GetSize() - 1]) {}
+
+        void Emit(const T& value) {
+            Prepare();
+            tail->items[tail->back_size++] = value;
+            deque->total_size++;
+        }
+
+        void Emit(T&& value) {
+            Prepare();
+            tail->items[tail->back_size++] = std::move(value);
+            deque->total_size++;
+        }
+
+        void Emit(const T* values, size_t count) {
+            while (count > 0) {
+                Prepare();
+                size_t room = tail->capacity - tail->back_size;
+                size_t copied = count < room ? count : room;
+
+                std::copy(values, values + copied, tail->items + tail->back_size);
+                tail->back_size += copied;
+                deque->total_size += copied;
+                values += copied;
+                count -= copied;
+            }
+        }
+
+        void operator()(const T& value) { Emit(value); }
+        void operator()(T&& value) { Emit(std::move(value)); }
+    private:
+        SegmentDeque* deque;
+        Segment<T>* tail;
+
+        void Prepare() {
+            if (tail->back_size == tail->capacity) {
+                deque->CheckBackCapacity();
+                tail = deque->segments[deque->segments.GetSize() - 1];
+            }
+        }
+    };
+
+    // Streaming FlatMap: func(value, emit) passes its outputs to a SegmentDeque<U>::Emitter
+    // writing straight into the result. size_hint(value), if given, returns how many outputs
+    // value will produce; the total is reserved before the first output is written.
+    template <typename U, typename Func>
+    SegmentDeque<U> FlatMap(Func func) const;
+
+    template <typename U, typename Func, typename SizeHint>
+    SegmentDeque<U> FlatMap(Func func, SizeHint size_hint) const;
+
     template <typename Func>
     T Reduce(Func func, T init) const;
 
+    // For arithmetic T the survivors are selected with branch-free block compaction (AVX2
+    // shuffles or AVX-512 compress stores for 4-byte types when the compiler targets them).
+    template <typename Func>
+    SegmentDeque<T, InlineCapacity> Where(Func predicate) const;
+
+    // In-place counterparts of Map and Where that never hold a second copy of the data.
+    // Transform replaces every element with func(element). RemoveIf drops the elements
+    // matching predicate and Retain keeps only those, moving survivors forward inside the
+    // existing segments and freeing the emptied tail segments; both return the number of
+    // removed elements. If predicate throws, the elements not yet tested are kept and the
+    // exception is rethrown.
     template <typename Func>
-    SegmentDeque<T> Where(Func predicate) const;
+    void Transform(Func func);
+
+    template <typename Predicate>
+    size_t RemoveIf(Predicate predicate);
+
+    template <typename Predicate>
+    size_t Retain(Predicate predicate);
+
+    // Sort groups of consecutive segments in place on separate threads, then merge the sorted
+    // runs pairwise into freshly packed segments. Drained segments are reused for the output,
+    // so no copy of the whole deque is made. StableSort keeps equal elements in their order.
+    template <typename Compare>
+    void Sort(Compare compare);
+    void Sort();
+
+    template <typename Compare>
+    void StableSort(Compare compare);
+    void StableSort();
+
+    // Writes the elements (or those in the half-open range [begin, end)) separated by separator,
+    // walking the segments once. Integers are formatted through a BufferedWriter, which hands
+    // the stream large blocks.
+    void WriteTo(std::ostream& stream, const std::string& separator = ", ") const;
+    void WriteTo(std::ostream& stream, const std::string& separator, size_t begin, size_t end) const;
+
+    template <typename Func>
+    void ForEach(Func func);
+
+    template <typename Func>
+    void ForEach(Func func) const;
 
     Iterator<T>* GetIterator() const;
     Iterator<T>* GetMutableIterator();
 
+    using SegmentDirectory = RingBuffer<Segment<T>*, 1>;
+
+    template <typename Value, typename Directory>
+    class ElementIterator {
+    public:
+        ElementIterator(Directory* segments, size_t segment)
+            : segments(segments), segment(segment), position(0) {
+            SkipEmptySegments();
+        }
+
+        Value& operator*() const { return (*(*segments)[segment])[position]; }
+        Value* operator->() const { return &(*(*segments)[segment])[position]; }
+
+        ElementIterator& operator++() {
+            if (++position >= (*segments)[segment]->GetEffectiveSize()) {
+                ++segment;
+                position = 0;
+                SkipEmptySegments();
+            }
+            return *this;
+        }
+
+        bool operator==(const ElementIterator& other) const { return segment == other.segment && position == other.position; }
+        bool operator!=(const ElementIterator& other) const { return !(*this == other); }
+    private:
+        Directory* segments;
+        size_t segment;
+        size_t position;
+
+        void SkipEmptySegments() {
+            while (segment < segments->GetSize() && (*segments)[segment]->IsEmpty()) {
+                ++segment;
+            }
+        }
+    };
+
+    using MutableElementIterator = ElementIterator<T, SegmentDirectory>;
+    using ConstElementIterator = ElementIterator<const T, const SegmentDirectory>;
+
+    MutableElementIterator begin() { return MutableElementIterator(&segments, 0); }
+    MutableElementIterator end() { return MutableElementIterator(&segments, segments.GetSize()); }
+    ConstElementIterator begin() const { return ConstElementIterator(&segments, 0); }
+    ConstElementIterator end() const { return ConstElementIterator(&segments, segments.GetSize()); }
+
 private:
     size_t segment_capacity;
+    size_t segment_alignment;
+    bool segment_huge_pages;
+    // Byte target the capacity came from, or 0 for a layout given in elements.
+    size_t segment_bytes;
     size_t total_size;
-    ListSequence<Segment<T>*>* segments;
-
+    SegmentDirectory segments;
+    Segment<T>* spare_segments;
+    size_t spare_count;
+    size_t spare_limit;
+    InlineStorage<T, InlineCapacity> inline_storage;
+    Segment<T> inline_segment;
+
+    Segment<T>* NewSegment() const;
+    void DeleteSegment(Segment<T>* segment) const;
+    Segment<T>* AcquireSegment();
+    void ReleaseSegment(Segment<T>* segment);
+    void DeleteSpareSegments();
+    void AllocateSpareSegments(size_t count);
+    void ResetSegments();
+    void TakeFrom(SegmentDeque<T, InlineCapacity>& deque);
+    void Spill();
     void CheckBackCapacity();
     void CheckFrontCapacity();
-    void CleanupEmptySegments();
+    void CheckIndex(size_t index) const;
+    T& Locate(size_t index) const;
+
+    template <typename Compare>
+    void SortRuns(Compare compare, bool stable);
+
+    static const size_t MIN_PARALLEL_RUN = 1 << 15;
+    static const size_t SORT_BUFFER_BYTES = 1 << 18;
 };
 
-template <typename T>
-SegmentDeque<T>::SegmentDeque(size_t segment_capacity)
-    : segment_capacity(segment_capacity),
+template <typename T, size_t InlineCapacity>
+SegmentDeque<T, InlineCapacity>::SegmentDeque(size_t segment_capacity)
+    : SegmentDeque(SegmentLayout::Elements(segment_capacity)) {}
+
+template <typename T, size_t InlineCapacity>
+SegmentDeque<T, InlineCapacity>::SegmentDeque(const SegmentLayout& layout)
+    : segment_capacity(layout.GetCapacity<T>()),
+      segment_alignment(layout.alignment),
+      segment_huge_pages(layout.huge_pages),
+      segment_bytes(layout.bytes),
       total_size(0),
-      segments(new ListSequence<Segment<T>*>()) {
+      spare_segments(nullptr),
+      spare_count(0),
+      spare_limit(0),
+      inline_segment(inline_storage.Data(), InlineCapacity) {
     if (segment_capacity == 0) {
         throw std::invalid_argument("segment_capacity == 0");
     }
 
-    Segment<T>* initial_segment = new Segment<T>(new MutableArraySequence<T>(segment_capacity));
-    segments->Append(initial_segment);
+    if ((segment_alignment & (segment_alignment - 1)) != 0) {
+        throw std::invalid_argument("Segment alignment must be zero or a power of two");
+    }
+
+    if (segment_alignment != 0 && segment_alignment < alignof(T)) {
+        segment_alignment = alignof(T);
+    }
+
+    ResetSegments();
 }
 
-template <typename T>
-SegmentDeque<T>::~SegmentDeque() {
-    for (size_t i = 0; i < segments->GetSize(); i++) {
-        delete segments->Get(i);
+template <typename T, size_t InlineCapacity>
+SegmentDeque<T, InlineCapacity>::SegmentDeque(const SegmentDeque<T, InlineCapacity>& deque)
+    : SegmentDeque(deque.GetSegmentLayout()) {
+    if (deque.total_size > InlineCapacity) {
+        ReserveBack(deque.total_size);
     }
 
-    delete segments;
+    deque.ForEach([&](const T& value) { Append(value); });
 }
 
-template <typename T>
-size_t SegmentDeque<T>::GetSegmentCount() const {
-    return segments->GetSize();
+template <typename T, size_t InlineCapacity>
+SegmentDeque<T, InlineCapacity>::SegmentDeque(SegmentDeque<T, InlineCapacity>&& deque)
+    : segment_capacity(deque.segment_capacity),
+      segment_alignment(deque.segment_alignment),
+      segment_huge_pages(deque.segment_huge_pages),
+      segment_bytes(deque.segment_bytes),
+      total_size(0),
+      spare_segments(nullptr),
+      spare_count(0),
+      spare_limit(0),
+      inline_segment(inline_storage.Data(), InlineCapacity) {
+    TakeFrom(deque);
 }
 
-template <typename T>
-const Segment<T>* SegmentDeque<T>::GetSegment(size_t index) const {
-    if (index >= segments->GetSize()) {
+template <typename T, size_t InlineCapacity>
+SegmentDeque<T, InlineCapacity>::~SegmentDeque() {
+    for (size_t i = 0; i < segments.GetSize(); i++) {
+        ReleaseSegment(segments[i]);
+    }
+
+    DeleteSpareSegments();
+}
+
+template <typename T, size_t InlineCapacity>
+SegmentDeque<T, InlineCapacity>& SegmentDeque<T, InlineCapacity>::operator=(const SegmentDeque<T, InlineCapacity>& deque) {
+    if (this != &deque) {
+        if (segment_capacity != deque.segment_capacity || segment_alignment != deque.segment_alignment ||
+            segment_huge_pages != deque.segment_huge_pages) {
+            // Segments of the old layout must not reach the spare pool of the new one.
+            for (size_t i = 0; i < segments.GetSize(); i++) {
+                ReleaseSegment(segments[i]);
+            }
+            segments.Clear();
+            DeleteSpareSegments();
+
+            segment_capacity = deque.segment_capacity;
+            segment_alignment = deque.segment_alignment;
+            segment_huge_pages = deque.segment_huge_pages;
+            ResetSegments();
+        }
+
+        segment_bytes = deque.segment_bytes;
+        Clear();
+
+        if (deque.total_size > InlineCapacity) {
+            ReserveBack(deque.total_size);
+        }
+
+        deque.ForEach([&](const T& value) { Append(value); });
+    }
+
+    return *this;
+}
+
+template <typename T, size_t InlineCapacity>
+SegmentDeque<T, InlineCapacity>& SegmentDeque<T, InlineCapacity>::operator=(SegmentDeque<T, InlineCapacity>&& deque) {
+    if (this != &deque) {
+        for (size_t i = 0; i < segments.GetSize(); i++) {
+            ReleaseSegment(segments[i]);
+        }
+        segments.Clear();
+        DeleteSpareSegments();
+
+        segment_capacity = deque.segment_capacity;
+        segment_alignment = deque.segment_alignment;
+        segment_huge_pages = deque.segment_huge_pages;
+        segment_bytes = deque.segment_bytes;
+        TakeFrom(deque);
+    }
+
+    return *this;
+}
+
+// Expects this deque to hold no segments; leaves the source empty but usable.
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::TakeFrom(SegmentDeque<T, InlineCapacity>& deque) {
+    if (deque.IsInline()) {
+        std::move(deque.inline_segment.items + deque.inline_segment.front_offset,
+                  deque.inline_segment.items + deque.inline_segment.back_size,
+                  inline_segment.items + deque.inline_segment.front_offset);
+        inline_segment.front_offset = deque.inline_segment.front_offset;
+        inline_segment.back_size = deque.inline_segment.back_size;
+        segments.Clear();
+        segments.PushBack(&inline_segment);
+    } else {
+        segments = std::move(deque.segments);
+    }
+
+    total_size = deque.total_size;
+    spare_segments = deque.spare_segments;
+    spare_count = deque.spare_count;
+    spare_limit = deque.spare_limit;
+
+    deque.segments.Clear();
+    deque.spare_segments = nullptr;
+    deque.spare_count = 0;
+    deque.ResetSegments();
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::ResetSegments() {
+    segments.Clear();
+    total_size = 0;
+
+    if (InlineCapacity > 0) {
+        inline_segment.front_offset = inline_segment.back_size = 0;
+        segments.PushBack(&inline_segment);
+    } else {
+        Segment<T>* segment = AcquireSegment();
+        segment->front_offset = segment->back_size = 0;
+        segments.PushBack(segment);
+    }
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::Clear() {
+    for (size_t i = 0; i < segments.GetSize(); i++) {
+        ReleaseSegment(segments[i]);
+    }
+
+    // Moving the directory out frees its heap slots; the deque is back to the inline one.
+    SegmentDirectory released(std::move(segments));
+    ResetSegments();
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::Resize(size_t size) {
+    if (size <= total_size) {
+        PopBack(total_size - size);
+        return;
+    }
+
+    size_t count = size - total_size;
+    ReserveBack(count);
+
+    while (count > 0) {
+        CheckBackCapacity();
+
+        Segment<T>* last = segments[segments.GetSize() - 1];
+        size_t room = last->capacity - last->back_size;
+        size_t added = count < room ? count : room;
+
+        std::fill(last->items + last->back_size, last->items + last->back_size + added, T());
+        last->back_size += added;
+        total_size += added;
+        count -= added;
+    }
+}
+
+template <typename T, size_t InlineCapacity>
+bool SegmentDeque<T, InlineCapacity>::IsInline() const {
+    return InlineCapacity > 0 && segments[0] == &inline_segment;
+}
+
+template <typename T, size_t InlineCapacity>
+Segment<T>* SegmentDeque<T, InlineCapacity>::NewSegment() const {
+    T* items = segment_alignment == 0 ? new T[segment_capacity]()
+                                      : Segment<T>::AllocateItems(segment_capacity, segment_alignment, segment_huge_pages);
+
+    try {
+        return new Segment<T>(items, segment_capacity);
+    } catch (...) {
+        if (segment_alignment == 0) {
+            delete[] items;
+        } else {
+            std::destroy_n(items, segment_capacity);
+            ::operator delete(items, std::align_val_t(segment_alignment));
+        }
+        throw;
+    }
+}
+
+// Heap segments always have the deque's current layout: a layout change deletes them first.
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::DeleteSegment(Segment<T>* segment) const {
+    if (segment->block) {
+        if (--segment->block->references == 0) {
+            delete segment->block;
+        }
+    } else if (segment_alignment == 0) {
+        delete[] segment->items;
+    } else {
+        std::destroy_n(segment->items, segment->capacity);
+        ::operator delete(segment->items, std::align_val_t(segment_alignment));
+    }
+
+    delete segment;
+}
+
+template <typename T, size_t InlineCapacity>
+Segment<T>* SegmentDeque<T, InlineCapacity>::AcquireSegment() {
+    if (!spare_segments) {
+        return NewSegment();
+    }
+
+    Segment<T>* segment = spare_segments;
+    spare_segments = segment->next_spare;
+    segment->next_spare = nullptr;
+    spare_count--;
+
+#ifndef NDEBUG
+    if (segment->capacity != segment_capacity) {
+        throw std::logic_error("Spare segment does not match the segment layout");
+    }
+#endif
+
+    return segment;
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::ReleaseSegment(Segment<T>* segment) {
+    if (segment == &inline_segment) {
+        return;
+    }
+
+    if (spare_count < spare_limit) {
+        segment->next_spare = spare_segments;
+        spare_segments = segment;
+        spare_count++;
+    } else {
+        DeleteSegment(segment);
+    }
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::DeleteSpareSegments() {
+    while (spare_segments) {
+        Segment<T>* next_segment = spare_segments->next_spare;
+        DeleteSegment(spare_segments);
+        spare_segments = next_segment;
+    }
+
+    spare_count = 0;
+}
+
+// Moves the elements of the inline segment into heap segments packed from the front.
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::Spill() {
+    size_t moved = 0;
+    size_t position = inline_segment.front_offset;
+
+    segments.Clear();
+
+    do {
+        Segment<T>* segment = AcquireSegment();
+        segment->front_offset = segment->back_size = 0;
+
+        while (segment->back_size < segment->capacity && moved < total_size) {
+            segment->items[segment->back_size++] = std::move(inline_segment.items[position++]);
+            moved++;
+        }
+
+        segments.PushBack(segment);
+    } while (moved < total_size);
+
+    inline_segment.front_offset = inline_segment.back_size = 0;
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::Reserve(size_t front_count, size_t back_count) {
+    if (IsInline() && (front_count > inline_segment.front_offset || back_count > InlineCapacity - inline_segment.back_size)) {
+        Spill();
+    }
+
+    size_t front_available = segments[0]->front_offset;
+    size_t back_available = segments[segments.GetSize() - 1]->capacity - segments[segments.GetSize() - 1]->back_size;
+
+    size_t needed = 0;
+
+    if (front_count > front_available) {
+        needed += (front_count - front_available + segment_capacity - 1) / segment_capacity;
+    }
+
+    if (back_count > back_available) {
+        needed += (back_count - back_available + segment_capacity - 1) / segment_capacity;
+    }
+
+    segments.Reserve(segments.GetSize() + needed);
+
+    if (spare_count < needed) {
+        AllocateSpareSegments(needed - spare_count);
+    }
+}
+
+// Adds count spare segments over one block of storage. A layout whose segment size is not a
+// multiple of its alignment cannot be packed back to back, so it gets one allocation per segment.
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::AllocateSpareSegments(size_t count) {
+    if (count == 1 || (segment_alignment != 0 && segment_capacity * sizeof(T) % segment_alignment != 0)) {
+        for (size_t i = 0; i < count; i++) {
+            Segment<T>* segment = NewSegment();
+            segment->next_spare = spare_segments;
+            spare_segments = segment;
+            spare_count++;
+        }
+        return;
+    }
+
+    SegmentBlock<T>* block = new SegmentBlock<T>(count * segment_capacity, segment_alignment, segment_huge_pages);
+
+    try {
+        for (size_t i = 0; i < count; i++) {
+            Segment<T>* segment = new Segment<T>(block->items + i * segment_capacity, segment_capacity, block);
+            block->references++;
+            segment->next_spare = spare_segments;
+            spare_segments = segment;
+            spare_count++;
+        }
+    } catch (...) {
+        if (block->references == 0) {
+            delete block;
+        }
+        throw;
+    }
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::ReserveFront(size_t count) {
+    Reserve(count, 0);
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::ReserveBack(size_t count) {
+    Reserve(0, count);
+}
+
+template <typename T, size_t InlineCapacity>
+size_t SegmentDeque<T, InlineCapacity>::GetSpareSegmentCount() const {
+    return spare_count;
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::SetSpareLimit(size_t limit) {
+    spare_limit = limit;
+}
+
+template <typename T, size_t InlineCapacity>
+size_t SegmentDeque<T, InlineCapacity>::GetSegmentCount() const {
+    return segments.GetSize();
+}
+
+template <typename T, size_t InlineCapacity>
+size_t SegmentDeque<T, InlineCapacity>::GetSegmentCapacity() const {
+    return segment_capacity;
+}
+
+template <typename T, size_t InlineCapacity>
+SegmentLayout SegmentDeque<T, InlineCapacity>::GetSegmentLayout() const {
+    return SegmentLayout{segment_capacity, segment_bytes, segment_alignment, segment_huge_pages};
+}
+
+template <typename T, size_t InlineCapacity>
+const Segment<T>* SegmentDeque<T, InlineCapacity>::GetSegment(size_t index) const {
+    if (index >= segments.GetSize()) {
         throw std::out_of_range("Segment index out of range");
     }
-    return segments->Get(index);
+    return segments.Get(index);
 }
 
-template <typename T>
-Segment<T>* SegmentDeque<T>::GetSegment(size_t index) {
-    if (index >= segments->GetSize()) {
+template <typename T, size_t InlineCapacity>
+Segment<T>* SegmentDeque<T, InlineCapacity>::GetSegment(size_t index) {
+    if (index >= segments.GetSize()) {
         throw std::out_of_range("Segment index out of range");
     }
-    return segments->Get(index);
+    return segments.Get(index);
 }
 
-template <typename T>
-void SegmentDeque<T>::CheckBackCapacity() {
-    Segment<T>* last = segments->Get(segments->GetSize() - 1);
+template <typename T, size_t InlineCapacity>
+size_t SegmentDeque<T, InlineCapacity>::GetSegmentIndex(size_t index) const {
+    CheckIndex(index);
+
+    size_t first_size = segments[0]->GetEffectiveSize();
+    return index < first_size ? 0 : 1 + (index - first_size) / segment_capacity;
+}
 
-    if (last->back_size >= segment_capacity) {
-        Segment<T>* new_segment = new Segment<T>(new MutableArraySequence<T>(segment_capacity));
-        segments->Append(new_segment);
+template <typename T, size_t InlineCapacity>
+size_t SegmentDeque<T, InlineCapacity>::GetSegmentStart(size_t segment) const {
+    if (segment >= segments.GetSize()) {
+        throw std::out_of_range("Segment index out of range");
+    }
+
+    if (segment == 0) {
+        return 0;
     }
+
+    return segments[0]->GetEffectiveSize() + (segment - 1) * segment_capacity;
 }
 
-template <typename T>
-void SegmentDeque<T>::CheckFrontCapacity() {
-    Segment<T>* first = segments->Get(0);
+template <typename T, size_t InlineCapacity>
+DequeMemoryUsage SegmentDeque<T, InlineCapacity>::MemoryUsage() const {
+    DequeMemoryUsage usage;
+    size_t slot_bytes = sizeof(T);
+    size_t inline_bytes = InlineCapacity * slot_bytes;
+
+    usage.metadata_bytes = sizeof(*this) - inline_bytes;
+    usage.slack_bytes = IsInline() ? 0 : inline_bytes;
+
+    if (segments.GetCapacity() > 1) {
+        usage.metadata_bytes += segments.GetCapacity() * sizeof(Segment<T>*);
+    }
+
+    for (size_t i = 0; i < segments.GetSize(); i++) {
+        const Segment<T>* segment = segments[i];
+        size_t size = segment->GetEffectiveSize();
+
+        usage.payload_bytes += size * slot_bytes;
+        usage.slack_bytes += (segment->capacity - size) * slot_bytes;
+
+        if (segment != &inline_segment) {
+            usage.metadata_bytes += sizeof(Segment<T>);
+        }
+
+        size_t bucket = size * DequeMemoryUsage::FILL_BUCKETS / segment->capacity;
+        usage.fill_histogram[bucket < DequeMemoryUsage::FILL_BUCKETS ? bucket : DequeMemoryUsage::FILL_BUCKETS - 1]++;
+    }
 
-    if (first->front_offset == 0) {
-        Segment<T>* new_segment = new Segment<T>(new MutableArraySequence<T>(segment_capacity));
-        new_segment->back_size = segment_capacity;
-        new_segment->front_offset = segment_capacity;
-        segments->Prepend(new_segment);
+    for (const Segment<T>* spare = spare_segments; spare; spare = spare->next_spare) {
+        usage.slack_bytes += spare->capacity * slot_bytes;
+        usage.metadata_bytes += sizeof(Segment<T>);
     }
+
+    return usage;
 }
 
-template <typename T>
-void SegmentDeque<T>::Append(const T& value) {
-    CheckBackCapacity();
+// A full inline segment that is at most half used is recentred instead of spilled,
+// so a small deque used as a queue stays off the heap.
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::CheckBackCapacity() {
+    Segment<T>* last = segments[segments.GetSize() - 1];
+
+    if (last->back_size < last->capacity) {
+        return;
+    }
+
+    if (last->IsEmpty()) {
+        last->front_offset = last->back_size = 0;
+    } else if (last == &inline_segment && total_size <= InlineCapacity / 2) {
+        std::move(last->items + last->front_offset, last->items + last->back_size, last->items);
+        last->front_offset = 0;
+        last->back_size = total_size;
+    } else {
+        if (last == &inline_segment) {
+            Spill();
+            last = segments[segments.GetSize() - 1];
+
+            if (last->back_size < last->capacity) {
+                return;
+            }
+        }
+
+        Segment<T>* new_segment = AcquireSegment();
+        new_segment->front_offset = new_segment->back_size = 0;
+        segments.PushBack(new_segment);
+    }
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::CheckFrontCapacity() {
+    Segment<T>* first = segments[0];
 
-    Segment<T>* last = segments->Get(segments->GetSize() - 1);
+    if (first->front_offset > 0) {
+        return;
+    }
 
-    if (last->back_size >= last->data->GetSize()) {
-        last->data->Append(value);
+    if (first->IsEmpty()) {
+        first->front_offset = first->back_size = first->capacity;
+    } else if (first == &inline_segment && total_size <= InlineCapacity / 2) {
+        std::move_backward(first->items + first->front_offset, first->items + first->back_size, first->items + InlineCapacity);
+        first->front_offset = InlineCapacity - total_size;
+        first->back_size = InlineCapacity;
     } else {
-        last->data->Set(value, last->back_size);
+        if (first == &inline_segment) {
+            Spill();
+        }
+
+        Segment<T>* new_segment = AcquireSegment();
+        new_segment->back_size = new_segment->capacity;
+        new_segment->front_offset = new_segment->capacity;
+        segments.PushFront(new_segment);
     }
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::Append(const T& value) {
+    CheckBackCapacity();
 
+    Segment<T>* last = segments[segments.GetSize() - 1];
+
+    last->items[last->back_size] = value;
     last->back_size++;
     total_size++;
 }
 
-template <typename T>
-void SegmentDeque<T>::Prepend(const T& value) {
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::Prepend(const T& value) {
     CheckFrontCapacity();
 
-    Segment<T>* first = segments->Get(0);
+    Segment<T>* first = segments[0];
 
     first->front_offset--;
-
-    if (first->front_offset < first->data->GetSize()) {
-        first->data->Set(value, first->front_offset);
-    } else {
-        throw std::runtime_error("Front capacity check failed");
-    }
-    
+    first->items[first->front_offset] = value;
     total_size++;
 }
 
-template <typename T>
-void SegmentDeque<T>::PopBack() {
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::PopBack() {
     if (total_size == 0) {
         throw std::out_of_range("PopBack from empty deque");
     }
 
-    for (int i = segments->GetSize() - 1; i >= 0; i--) {
-        Segment<T>* segment = segments->Get(i);
-        if (!segment->IsEmpty()) {
-            segment->back_size--;
-            total_size--;
-            break;
-        }
-    }
-
-    CleanupEmptySegments();
+    PopBack(1);
 }
 
-template <typename T>
-void SegmentDeque<T>::PopFront() {
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::PopFront() {
     if (total_size == 0) {
         throw std::out_of_range("PopFront from empty deque");
     }
 
-    for (size_t i = 0; i < segments->GetSize(); i++) {
-        Segment<T>* segment = segments->Get(i);
-        if (!segment->IsEmpty()) {
-            segment->front_offset++;
-            total_size--;
-            break;
-        }
+    PopFront(1);
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::PopBack(size_t count) {
+    if (count > total_size) {
+        throw std::out_of_range("PopBack of " + std::to_string(count) + " elements from deque of size " + std::to_string(total_size));
     }
 
-    CleanupEmptySegments();
+    while (count > 0) {
+        Segment<T>* last = segments[segments.GetSize() - 1];
+        size_t removed = count < last->GetEffectiveSize() ? count : last->GetEffectiveSize();
+
+        last->back_size -= removed;
+        total_size -= removed;
+        count -= removed;
+
+        if (last->IsEmpty() && segments.GetSize() > 1) {
+            ReleaseSegment(last);
+            segments.PopBack();
+        }
+    }
 }
 
-template <typename T>
-void SegmentDeque<T>::CleanupEmptySegments() {
-    while (segments->GetSize() > 1 && segments->Get(0)->IsEmpty()) {
-        delete segments->Get(0);
-        segments->RemoveNode(0);
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::PopFront(size_t count) {
+    if (count > total_size) {
+        throw std::out_of_range("PopFront of " + std::to_string(count) + " elements from deque of size " + std::to_string(total_size));
     }
 
-    while (segments->GetSize() > 1 && segments->Get(segments->GetSize() - 1)->IsEmpty()) {
-        delete segments->Get(segments->GetSize() - 1);
-        segments->RemoveNode(segments->GetSize() - 1);
+    while (count > 0) {
+        Segment<T>* first = segments[0];
+        size_t removed = count < first->GetEffectiveSize() ? count : first->GetEffectiveSize();
+
+        first->front_offset += removed;
+        total_size -= removed;
+        count -= removed;
+
+        if (first->IsEmpty() && segments.GetSize() > 1) {
+            ReleaseSegment(first);
+            segments.PopFront();
+        }
     }
 }
 
-template <typename T>
-T& SegmentDeque<T>::Get(size_t index) {
-    if (index >= total_size) {
-        throw std::out_of_range("Index out of range");
-    }
+template <typename T, size_t InlineCapacity>
+template <typename OutputIt>
+size_t SegmentDeque<T, InlineCapacity>::DrainFront(OutputIt out, size_t count) {
+    size_t drained = 0;
 
-    size_t current_index = 0;
-    for (size_t i = 0; i < segments->GetSize(); i++) {
-        Segment<T>* segment = segments->Get(i);
-        size_t segment_size = segment->GetEffectiveSize();
+    while (drained < count && total_size > 0) {
+        Segment<T>* first = segments[0];
+        size_t available = first->GetEffectiveSize();
+        size_t taken = count - drained < available ? count - drained : available;
 
-        if (current_index + segment_size > index) {
-            return segment->Get(index - current_index);
+        for (size_t i = 0; i < taken; i++) {
+            *out = std::move((*first)[i]);
+            ++out;
         }
 
-        current_index += segment_size;
+        drained += taken;
+        PopFront(taken);
     }
 
-    throw std::out_of_range("Index calculation error");
+    return drained;
 }
 
-template <typename T>
-const T& SegmentDeque<T>::Get(size_t index) const {
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::CheckIndex(size_t index) const {
     if (index >= total_size) {
         throw std::out_of_range("Index out of range");
     }
+}
 
-    size_t current_index = 0;
-    for (size_t i = 0; i < segments->GetSize(); i++) {
-        Segment<T>* segment = segments->Get(i);
-        size_t segment_size = segment->GetEffectiveSize();
+// Every segment except the first starts at offset 0 and all but the last are full,
+// so an element is found by arithmetic instead of a walk over the segments. Debug builds
+// check that the segment found really has the deque's capacity.
+template <typename T, size_t InlineCapacity>
+T& SegmentDeque<T, InlineCapacity>::Locate(size_t index) const {
+    Segment<T>* first = segments[0];
+    size_t first_size = first->GetEffectiveSize();
 
-        if (current_index + segment_size > index) {
-            return segment->Get(index - current_index);
-        }
+    if (index < first_size) {
+        return (*first)[index];
+    }
+
+    index -= first_size;
+    Segment<T>* segment = segments[1 + index / segment_capacity];
 
-        current_index += segment_size;
+#ifndef NDEBUG
+    if (segment->capacity != segment_capacity || segment->front_offset != 0) {
+        throw std::logic_error("Interior segment does not match the segment layout");
     }
+#endif
 
-    throw std::out_of_range("Index calculation error");
+    return segment->items[index % segment_capacity];
 }
 
-template <typename T>
-size_t SegmentDeque<T>::GetSize() const {
+template <typename T, size_t InlineCapacity>
+T& SegmentDeque<T, InlineCapacity>::Get(size_t index) {
+    CheckIndex(index);
+    return Locate(index);
+}
+
+template <typename T, size_t InlineCapacity>
+const T& SegmentDeque<T, InlineCapacity>::Get(size_t index) const {
+    CheckIndex(index);
+    return Locate(index);
+}
+
+template <typename T, size_t InlineCapacity>
+T& SegmentDeque<T, InlineCapacity>::At(size_t index) {
+    CheckIndex(index);
+    return Locate(index);
+}
+
+template <typename T, size_t InlineCapacity>
+const T& SegmentDeque<T, InlineCapacity>::At(size_t index) const {
+    CheckIndex(index);
+    return Locate(index);
+}
+
+template <typename T, size_t InlineCapacity>
+T& SegmentDeque<T, InlineCapacity>::operator[](size_t index) {
+#ifndef NDEBUG
+    CheckIndex(index);
+#endif
+    return Locate(index);
+}
+
+template <typename T, size_t InlineCapacity>
+const T& SegmentDeque<T, InlineCapacity>::operator[](size_t index) const {
+#ifndef NDEBUG
+    CheckIndex(index);
+#endif
+    return Locate(index);
+}
+
+template <typename T, size_t InlineCapacity>
+size_t SegmentDeque<T, InlineCapacity>::GetSize() const {
     return total_size;
 }
 
-template <typename T>
-bool SegmentDeque<T>::IsEmpty() const {
+template <typename T, size_t InlineCapacity>
+bool SegmentDeque<T, InlineCapacity>::IsEmpty() const {
     return total_size == 0;
 }
 
-template <typename T>
+template <typename T, size_t InlineCapacity>
+size_t SegmentDeque<T, InlineCapacity>::LowerBound(const T& value) const {
+    return LowerBound(value, std::less<T>());
+}
+
+template <typename T, size_t InlineCapacity>
+size_t SegmentDeque<T, InlineCapacity>::UpperBound(const T& value) const {
+    return UpperBound(value, std::less<T>());
+}
+
+template <typename T, size_t InlineCapacity>
+std::pair<size_t, size_t> SegmentDeque<T, InlineCapacity>::EqualRange(const T& value) const {
+    return EqualRange(value, std::less<T>());
+}
+
+template <typename T, size_t InlineCapacity>
+template <typename Compare>
+size_t SegmentDeque<T, InlineCapacity>::LowerBound(const T& value, Compare compare) const {
+    if (total_size == 0) {
+        return 0;
+    }
+
+    // Count the segments whose fence key is less than value; the answer lies in the last of them.
+    size_t low = 0;
+    size_t high = segments.GetSize();
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if (compare((*segments[middle])[0], value)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low == 0) {
+        return 0;
+    }
+
+    const Segment<T>* segment = segments[low - 1];
+    const T* begin = segment->items + segment->front_offset;
+    const T* end = segment->items + segment->back_size;
+
+    return GetSegmentStart(low - 1) + (std::lower_bound(begin, end, value, compare) - begin);
+}
+
+template <typename T, size_t InlineCapacity>
+template <typename Compare>
+size_t SegmentDeque<T, InlineCapacity>::UpperBound(const T& value, Compare compare) const {
+    if (total_size == 0) {
+        return 0;
+    }
+
+    // Count the segments whose fence key is not greater than value.
+    size_t low = 0;
+    size_t high = segments.GetSize();
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if (!compare(value, (*segments[middle])[0])) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low == 0) {
+        return 0;
+    }
+
+    const Segment<T>* segment = segments[low - 1];
+    const T* begin = segment->items + segment->front_offset;
+    const T* end = segment->items + segment->back_size;
+
+    return GetSegmentStart(low - 1) + (std::upper_bound(begin, end, value, compare) - begin);
+}
+
+template <typename T, size_t InlineCapacity>
+template <typename Compare>
+std::pair<size_t, size_t> SegmentDeque<T, InlineCapacity>::EqualRange(const T& value, Compare compare) const {
+    return std::make_pair(LowerBound(value, compare), UpperBound(value, compare));
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::WriteTo(std::ostream& stream, const std::string& separator) const {
+    WriteTo(stream, separator, 0, total_size);
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::WriteTo(std::ostream& stream, const std::string& separator, size_t begin, size_t end) const {
+    if (begin > end || end > total_size) {
+        throw std::out_of_range("Range [" + std::to_string(begin) + ", " + std::to_string(end) +
+                                ") is out of range for deque of size " + std::to_string(total_size));
+    }
+
+    if (begin == end) {
+        return;
+    }
+
+    BufferedWriter writer(stream);
+
+    // Floating-point values go through to_chars unless the stream asks for something it
+    // does not produce (hexfloat's 0x prefix, showpoint, showpos, uppercase).
+    std::ios_base::fmtflags flags = stream.flags();
+    std::ios_base::fmtflags float_field = flags & std::ios_base::floatfield;
+    bool plain_floats = (flags & (std::ios_base::showpoint | std::ios_base::showpos | std::ios_base::uppercase)) == 0 &&
+                        float_field != (std::ios_base::fixed | std::ios_base::scientific);
+    std::chars_format float_format = float_field == std::ios_base::fixed        ? std::chars_format::fixed
+                                     : float_field == std::ios_base::scientific ? std::chars_format::scientific
+                                                                                : std::chars_format::general;
+    int precision = static_cast<int>(stream.precision());
+
+    size_t segment = GetSegmentIndex(begin);
+    size_t offset = begin - GetSegmentStart(segment);
+    size_t remaining = end - begin;
+    bool first = true;
+
+    while (remaining > 0) {
+        const Segment<T>* current = segments[segment];
+        size_t available = current->GetEffectiveSize() - offset;
+        size_t count = remaining < available ? remaining : available;
+
+        if constexpr (IsPrintedAsInteger<T>::value) {
+            for (size_t i = offset; i < offset + count; i++) {
+                if (!first) {
+                    writer.Write(separator);
+                }
+                first = false;
+
+                writer.WriteInteger((*current)[i]);
+            }
+        } else {
+            bool formatted = false;
+
+            if constexpr (std::is_floating_point<T>::value) {
+                if (plain_floats) {
+                    for (size_t i = offset; i < offset + count; i++) {
+                        if (!first) {
+                            writer.Write(separator);
+                        }
+                        first = false;
+
+                        writer.WriteFloat((*current)[i], float_format, precision);
+                    }
+                    formatted = true;
+                }
+            }
+
+            if (!formatted) {
+                // One formatting stream per segment, sharing the target's flags.
+                std::ostringstream block;
+                block.copyfmt(stream);
+
+                for (size_t i = offset; i < offset + count; i++) {
+                    if (!first) {
+                        block << separator;
+                    }
+                    first = false;
+
+                    block << (*current)[i];
+                }
+
+                writer.Write(block.str());
+            }
+        }
+
+        remaining -= count;
+        offset = 0;
+        segment++;
+    }
+
+    writer.Close();
+}
+
+template <typename T, size_t InlineCapacity>
 template <typename Func>
-auto SegmentDeque<T>::Map(Func func) const -> SegmentDeque<decltype(func(std::declval<T>()))> {
-    using U = decltype(func(std::declval<T>()));
-    SegmentDeque<U> result(segment_capacity);
+void SegmentDeque<T, InlineCapacity>::ForEach(Func func) {
+    for (size_t i = 0; i < segments.GetSize(); i++) {
+        segments[i]->ForEach([&](T& value) { func(value); });
+    }
+}
 
-    for (size_t i = 0; i < GetSize(); ++i) {
-        result.Append(func(Get(i)));
+template <typename T, size_t InlineCapacity>
+template <typename Func>
+void SegmentDeque<T, InlineCapacity>::ForEach(Func func) const {
+    for (size_t i = 0; i < segments.GetSize(); i++) {
+        const Segment<T>* segment = segments[i];
+        segment->ForEach([&](const T& value) { func(value); });
     }
+}
+
+template <typename T, size_t InlineCapacity>
+template <typename Func>
+auto SegmentDeque<T, InlineCapacity>::Map(Func func) const -> SegmentDeque<decltype(func(std::declval<T>()))> {
+    using U = decltype(func(std::declval<T>()));
+    SegmentDeque<U> result(GetSegmentLayout());
+
+    ForEach([&](const T& value) {
+        result.Append(func(value));
+    });
 
     return result;
 }
 
-template <typename T>
+template <typename T, size_t InlineCapacity>
 template <typename Func>
-auto SegmentDeque<T>::FlatMap(Func func) const -> SegmentDeque<typename decltype(func(std::declval<T>()))::value_type> {
+auto SegmentDeque<T, InlineCapacity>::FlatMap(Func func) const -> SegmentDeque<typename decltype(func(std::declval<T>()))::value_type> {
     using Container = decltype(func(std::declval<T>()));
     using U = typename Container::value_type;
 
-    SegmentDeque<U> result(segment_capacity);
+    SegmentDeque<U> result(GetSegmentLayout());
 
-    for (size_t i = 0; i < GetSize(); ++i) {
-        Container intermediate = func(Get(i));
+    ForEach([&](const T& value) {
+        Container intermediate = func(value);
 
         for (size_t j = 0; j < intermediate.GetSize(); ++j) {
             result.Append(intermediate.Get(j));
         }
-    }
+    });
 
     return result;
 }
 
-template <typename T>
+template <typename T, size_t InlineCapacity>
+template <typename U, typename Func>
+SegmentDeque<U> SegmentDeque<T, InlineCapacity>::FlatMap(Func func) const {
+    SegmentDeque<U> result(GetSegmentLayout());
+    typename SegmentDeque<U>::Emitter emit(result);
+
+    ForEach([&](const T& value) {
+        func(value, emit);
+    });
+
+    return result;
+}
+
+template <typename T, size_t InlineCapacity>
+template <typename U, typename Func, typename SizeHint>
+SegmentDeque<U> SegmentDeque<T, InlineCapacity>::FlatMap(Func func, SizeHint size_hint) const {
+    size_t expected = 0;
+
+    ForEach([&](const T& value) {
+        expected += size_hint(value);
+    });
+
+    SegmentDeque<U> result(GetSegmentLayout());
+    result.ReserveBack(expected);
+    typename SegmentDeque<U>::Emitter emit(result);
+
+    ForEach([&](const T& value) {
+        func(value, emit);
+    });
+
+    return result;
+}
+
+template <typename T, size_t InlineCapacity>
 template <typename Func>
-T SegmentDeque<T>::Reduce(Func func, T init) const {
+T SegmentDeque<T, InlineCapacity>::Reduce(Func func, T init) const {
     T result = init;
 
-    for (size_t i = 0; i < GetSize(); ++i) {
-        result = func(result, Get(i));
-    }
+    ForEach([&](const T& value) {
+        result = func(result, value);
+    });
 
     return result;
 }
 
-template <typename T>
+template <typename T, size_t InlineCapacity>
 template <typename Func>
-SegmentDeque<T> SegmentDeque<T>::Where(Func predicate) const {
-    SegmentDeque<T> result(segment_capacity);
+SegmentDeque<T, InlineCapacity> SegmentDeque<T, InlineCapacity>::Where(Func predicate) const {
+    SegmentDeque<T, InlineCapacity> result(GetSegmentLayout());
+
+    if constexpr (std::is_arithmetic<T>::value && StreamCompaction::HasSimdCompress<T>()) {
+        // Survivors are compacted block by block into a small staging buffer without a branch
+        // per element, so the cost does not depend on how predictable the predicate is.
+        const size_t BLOCK_SIZE = StreamCompaction::BLOCK_SIZE;
+        const size_t MASK_SIZE = StreamCompaction::MASK_SIZE;
+        const size_t STAGE_SIZE = 256;
+        T staged[STAGE_SIZE + MASK_SIZE];
+        size_t staged_count = 0;
+        Emitter emit(result);
+
+        auto flush = [&]() {
+            emit.Emit(staged, staged_count);
+            staged_count = 0;
+        };
+
+        for (size_t s = 0; s < segments.GetSize(); s++) {
+            const T* source = segments[s]->items + segments[s]->front_offset;
+            size_t size = segments[s]->GetEffectiveSize();
+            size_t i = 0;
+
+            for (; i + MASK_SIZE <= size; i += MASK_SIZE) {
+                uint32_t mask = StreamCompaction::Mask(source + i, predicate);
+
+                for (size_t block = 0; block < MASK_SIZE; block += BLOCK_SIZE) {
+                    staged_count += StreamCompaction::CompressBlock(source + i + block, (mask >> block) & 0xFF,
+                                                                    staged + staged_count);
+                }
+
+                if (staged_count >= STAGE_SIZE) {
+                    flush();
+                }
+            }
 
-    for (size_t i = 0; i < GetSize(); ++i) {
-        if (predicate(Get(i))) {
-            result.Append(Get(i));
+            if (i < size) {
+                uint32_t mask = StreamCompaction::Mask(source + i, size - i, predicate);
+                staged_count += StreamCompaction::Compress(source + i, size - i, mask, staged + staged_count);
+
+                if (staged_count >= STAGE_SIZE) {
+                    flush();
+                }
+            }
         }
+
+        flush();
+    } else {
+        ForEach([&](const T& value) {
+            if (predicate(value)) {
+                result.Append(value);
+            }
+        });
     }
 
     return result;
 }
 
-template <typename T>
-class ConstDequeIterator : public Iterator<T> {
-public:
-    explicit ConstDequeIterator(const SegmentDeque<T>* deque) : container(deque), segment_idx(0), pos_in_segment(0), started(false) {}
+template <typename T, size_t InlineCapacity>
+template <typename Func>
+void SegmentDeque<T, InlineCapacity>::Transform(Func func) {
+    for (size_t s = 0; s < segments.GetSize(); s++) {
+        Segment<T>* segment = segments[s];
 
-    bool Next() override {
-        if (!started) {
-            started = true;
+        for (size_t i = segment->front_offset; i < segment->back_size; i++) {
+            segment->items[i] = func(segment->items[i]);
+        }
+    }
+}
 
-            while (segment_idx < container->GetSegmentCount() && container->GetSegment(segment_idx)->IsEmpty()) {
-                segment_idx++;
+template <typename T, size_t InlineCapacity>
+template <typename Predicate>
+size_t SegmentDeque<T, InlineCapacity>::RemoveIf(Predicate predicate) {
+    size_t write_segment = 0;
+    size_t write_position = segments[0]->front_offset;
+    size_t kept = 0;
+    std::exception_ptr error;
+
+    for (size_t s = 0; s < segments.GetSize(); s++) {
+        Segment<T>* segment = segments[s];
+
+        for (size_t i = segment->front_offset; i < segment->back_size; i++) {
+            bool removed = false;
+
+            if (!error) {
+                try {
+                    removed = predicate(segment->items[i]);
+                } catch (...) {
+                    error = std::current_exception();
+                }
             }
 
-            return segment_idx < container->GetSegmentCount();
-        }
+            if (removed) {
+                continue;
+            }
 
-        if (segment_idx >= container->GetSegmentCount()) {
-            return false;
+            if (write_position == segments[write_segment]->capacity) {
+                write_segment++;
+                write_position = 0;
+            }
+
+            if (write_segment != s || write_position != i) {
+                segments[write_segment]->items[write_position] = std::move(segment->items[i]);
+            }
+
+            write_position++;
+            kept++;
         }
+    }
+
+    size_t removed = total_size - kept;
+    PopBack(removed);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return removed;
+}
+
+template <typename T, size_t InlineCapacity>
+template <typename Predicate>
+size_t SegmentDeque<T, InlineCapacity>::Retain(Predicate predicate) {
+    return RemoveIf([&](const T& value) { return !predicate(value); });
+}
+
+template <typename T, size_t InlineCapacity>
+template <typename Compare>
+void SegmentDeque<T, InlineCapacity>::Sort(Compare compare) {
+    SortRuns(compare, false);
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::Sort() {
+    SortRuns(std::less<T>(), false);
+}
+
+template <typename T, size_t InlineCapacity>
+template <typename Compare>
+void SegmentDeque<T, InlineCapacity>::StableSort(Compare compare) {
+    SortRuns(compare, true);
+}
+
+template <typename T, size_t InlineCapacity>
+void SegmentDeque<T, InlineCapacity>::StableSort() {
+    SortRuns(std::less<T>(), true);
+}
+
+template <typename T, size_t InlineCapacity>
+template <typename Compare>
+void SegmentDeque<T, InlineCapacity>::SortRuns(Compare compare, bool stable) {
+    auto sort_segment = [&](Segment<T>* segment) {
+        T* first = segment->items + segment->front_offset;
+        T* last = segment->items + segment->back_size;
 
-        const Segment<T>* segment = container->GetSegment(segment_idx);
-        pos_in_segment++;
+        stable ? std::stable_sort(first, last, compare) : std::sort(first, last, compare);
+    };
+
+    if (segments.GetSize() == 1) {
+        sort_segment(segments[0]);
+        return;
+    }
 
-        if (pos_in_segment >= segment->GetEffectiveSize()) {
-            segment_idx++;
-            pos_in_segment = 0;
+    size_t thread_count = std::thread::hardware_concurrency();
+    size_t max_threads = total_size / MIN_PARALLEL_RUN;
 
-            while (segment_idx < container->GetSegmentCount() && container->GetSegment(segment_idx)->IsEmpty()) {
-                segment_idx++;
+    thread_count = thread_count < max_threads ? thread_count : max_threads;
+    thread_count = thread_count < segments.GetSize() ? thread_count : segments.GetSize();
+    thread_count = thread_count > 0 ? thread_count : 1;
+
+    std::vector<std::exception_ptr> errors(thread_count);
+
+    // Runs body(index, thread) for every index below count, each thread taking a contiguous range.
+    auto parallel_for = [&](size_t count, auto body) {
+        auto work = [&](size_t thread) {
+            try {
+                for (size_t i = thread * count / thread_count; i < (thread + 1) * count / thread_count; i++) {
+                    body(i, thread);
+                }
+            } catch (...) {
+                errors[thread] = std::current_exception();
             }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < thread_count; i++) {
+            workers.emplace_back(work, i);
+        }
+        work(0);
+        for (std::thread& worker : workers) {
+            worker.join();
         }
+    };
 
-        return segment_idx < container->GetSegmentCount();
+    auto first_error = [&]() {
+        for (const std::exception_ptr& error : errors) {
+            if (error) {
+                return error;
+            }
+        }
+        return std::exception_ptr(nullptr);
+    };
+
+    // The first runs are groups of consecutive segments of about SORT_BUFFER_BYTES together.
+    // A group is sorted through a buffer of that size and written back into its own segments;
+    // a segment larger than the buffer is a group of its own and is sorted where it lies.
+    size_t buffer_elements = SORT_BUFFER_BYTES / sizeof(T) > 0 ? SORT_BUFFER_BYTES / sizeof(T) : 1;
+    std::vector<size_t> group_begin;
+    size_t group_size = 0;
+
+    for (size_t i = 0; i < segments.GetSize(); i++) {
+        size_t size = segments[i]->GetEffectiveSize();
+
+        if (group_begin.empty() || group_size + size > buffer_elements) {
+            group_begin.push_back(i);
+            group_size = 0;
+        }
+        group_size += size;
     }
+    group_begin.push_back(segments.GetSize());
 
-    T& Get() override {
-        if (!started || segment_idx >= container->GetSegmentCount()) {
-            throw std::out_of_range("Iterator out of range");
+    size_t group_count = group_begin.size() - 1;
+    std::vector<std::vector<T>> buffers(thread_count);
+
+    // A failed sort leaves each group holding a permutation of its own elements.
+    parallel_for(group_count, [&](size_t group, size_t thread) {
+        size_t begin = group_begin[group];
+        size_t end = group_begin[group + 1];
+
+        if (end - begin == 1) {
+            sort_segment(segments[begin]);
+            return;
         }
 
-        const Segment<T>* segment = container->GetSegment(segment_idx);
-        return const_cast<Segment<T>*>(segment)->Get(pos_in_segment);
-    }
+        std::vector<T>& buffer = buffers[thread];
+        std::exception_ptr failure = nullptr;
 
-private:
-    const SegmentDeque<T>* container;
-    size_t segment_idx;
-    size_t pos_in_segment;
-    bool started;
-};
+        // Reserved up front: a reallocation failing halfway would strand moved-out elements.
+        buffer.clear();
+        buffer.reserve(buffer_elements);
+        for (size_t i = begin; i < end; i++) {
+            Segment<T>* segment = segments[i];
+            std::move(segment->items + segment->front_offset, segment->items + segment->back_size, std::back_inserter(buffer));
+        }
 
-template <typename T>
-class MutableDequeIterator : public Iterator<T> {
-public:
-    explicit MutableDequeIterator(SegmentDeque<T>* deque) : container(deque), segment_idx(0), pos_in_segment(0), started(false) {}
+        try {
+            stable ? std::stable_sort(buffer.begin(), buffer.end(), compare) : std::sort(buffer.begin(), buffer.end(), compare);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+
+        T* source = buffer.data();
+        for (size_t i = begin; i < end; i++) {
+            Segment<T>* segment = segments[i];
+            std::move(source, source + segment->GetEffectiveSize(), segment->items + segment->front_offset);
+            source += segment->GetEffectiveSize();
+        }
+
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    });
+
+    buffers.clear();
+
+    if (std::exception_ptr error = first_error()) {
+        std::rethrow_exception(error);
+    }
+
+    // Every group is now a sorted run. Each pass merges neighbouring pairs of runs into freshly
+    // packed segments, reading the inputs through cursors into their storage. Drained inputs go
+    // to the merging thread's pool and become output, so a thread holds at most three segments
+    // beyond the deque's own.
+    std::vector<std::vector<Segment<T>*>> runs(group_count);
+    for (size_t group = 0; group < group_count; group++) {
+        for (size_t i = group_begin[group]; i < group_begin[group + 1]; i++) {
+            runs[group].push_back(segments[i]);
+        }
+    }
 
-    bool Next() override {
-        if (!started) {
-            started = true;
+    std::vector<Segment<T>*> pools(thread_count, nullptr);
+    std::mutex acquire_mutex;
+
+    auto recycle = [&](Segment<T>* segment, size_t thread) {
+        segment->front_offset = segment->back_size = 0;
+        segment->next_spare = pools[thread];
+        pools[thread] = segment;
+    };
+
+    // output has room reserved for every segment it can receive, so push_back does not throw.
+    auto add_segment = [&](std::vector<Segment<T>*>& output, size_t thread) {
+        Segment<T>* segment = pools[thread];
+
+        if (segment) {
+            pools[thread] = segment->next_spare;
+            segment->next_spare = nullptr;
+        } else {
+            std::lock_guard<std::mutex> lock(acquire_mutex);
+            segment = AcquireSegment();
+            segment->front_offset = segment->back_size = 0;
+        }
 
-            while (segment_idx < container->GetSegmentCount() && container->GetSegment(segment_idx)->IsEmpty()) {
-                segment_idx++;
+        output.push_back(segment);
+        return segment;
+    };
+
+    // Reads a run from front to back; a drained segment is recycled as soon as it is left.
+    struct RunCursor {
+        std::vector<Segment<T>*>* run;
+        size_t position;
+        T* current;
+        T* limit;
+    };
+
+    // Moves cursor to the next segment that holds elements; an exhausted cursor has a null current.
+    auto load = [&](RunCursor& cursor, size_t thread) {
+        while (cursor.position < cursor.run->size()) {
+            Segment<T>* segment = (*cursor.run)[cursor.position];
+
+            if (!segment->IsEmpty()) {
+                cursor.current = segment->items + segment->front_offset;
+                cursor.limit = segment->items + segment->back_size;
+                return;
             }
 
-            return segment_idx < container->GetSegmentCount();
+            recycle(segment, thread);
+            cursor.position++;
         }
 
-        if (segment_idx >= container->GetSegmentCount()) return false;
+        cursor.current = nullptr;
+    };
+
+    auto advance = [&](RunCursor& cursor, size_t thread) {
+        recycle((*cursor.run)[cursor.position++], thread);
+        load(cursor, thread);
+    };
+
+    std::vector<std::vector<Segment<T>*>> merged;
+    std::exception_ptr error = nullptr;
+
+    while (runs.size() > 1 && !error) {
+        merged.assign((runs.size() + 1) / 2, std::vector<Segment<T>*>());
+
+        parallel_for(merged.size(), [&](size_t pair, size_t thread) {
+            std::vector<Segment<T>*>& output = merged[pair];
+
+            if (2 * pair + 1 == runs.size()) {
+                output = std::move(runs[2 * pair]);
+                return;
+            }
+
+            RunCursor left{&runs[2 * pair], 0, nullptr, nullptr};
+            RunCursor right{&runs[2 * pair + 1], 0, nullptr, nullptr};
+            Segment<T>* out = nullptr;
+            T* next = nullptr;
+            T* out_limit = nullptr;
+
+            auto sync_output = [&]() {
+                if (out) {
+                    out->back_size = next - out->items;
+                }
+            };
+
+            auto next_output = [&]() {
+                sync_output();
+                out = add_segment(output, thread);
+                next = out->items;
+                out_limit = out->items + out->capacity;
+            };
+
+            try {
+                output.reserve(left.run->size() + right.run->size());
+                load(left, thread);
+                load(right, thread);
+
+                // No cursor can cross a segment boundary within steps elements, so the inner loop
+                // only compares and moves. Taking the left element on ties keeps StableSort stable.
+                while (left.current && right.current) {
+                    if (next == out_limit) {
+                        next_output();
+                    }
+
+                    size_t steps = std::min({static_cast<size_t>(left.limit - left.current),
+                                             static_cast<size_t>(right.limit - right.current),
+                                             static_cast<size_t>(out_limit - next)});
+
+                    for (; steps > 0; steps--) {
+                        bool take_right = compare(*right.current, *left.current);
+                        *next++ = std::move(take_right ? *right.current : *left.current);
+                        right.current += take_right;
+                        left.current += !take_right;
+                    }
+
+                    if (left.current == left.limit) {
+                        advance(left, thread);
+                    }
+                    if (right.current == right.limit) {
+                        advance(right, thread);
+                    }
+                }
+
+                RunCursor& rest = left.current ? left : right;
+
+                while (rest.current) {
+                    if (next == out_limit) {
+                        next_output();
+                    }
+
+                    size_t steps = std::min(rest.limit - rest.current, out_limit - next);
+                    next = std::move(rest.current, rest.current + steps, next);
+                    rest.current += steps;
+
+                    if (rest.current == rest.limit) {
+                        advance(rest, thread);
+                    }
+                }
+
+                sync_output();
+            } catch (...) {
+                // Keep the unmerged segments after the output; the deque is repacked below.
+                sync_output();
+
+                for (RunCursor* cursor : {&left, &right}) {
+                    std::vector<Segment<T>*>& run = *cursor->run;
+
+                    if (cursor->current && cursor->position < run.size()) {
+                        run[cursor->position]->front_offset = cursor->current - run[cursor->position]->items;
+                    }
+                    output.insert(output.end(), run.begin() + cursor->position, run.end());
+                }
+
+                // Recorded rather than rethrown so the thread still passes its later pairs along.
+                errors[thread] = std::current_exception();
+            }
+        });
+
+        runs.swap(merged);
+        error = first_error();
+    }
 
-        Segment<T>* segment = container->GetSegment(segment_idx);
-        pos_in_segment++;
+    segments.Clear();
 
-        if (pos_in_segment >= segment->GetEffectiveSize()) {
-            segment_idx++;
-            pos_in_segment = 0;
+    if (!error) {
+        segments.Reserve(runs[0].size());
+        for (Segment<T>* segment : runs[0]) {
+            segments.PushBack(segment);
+        }
+    } else {
+        // Runs left by a failed pass may hold partial segments anywhere; pack them from the front.
+        std::vector<Segment<T>*> packed;
+        size_t segment_count = 0;
 
-            while (segment_idx < container->GetSegmentCount() && container->GetSegment(segment_idx)->IsEmpty()) {
-                segment_idx++;
+        for (const std::vector<Segment<T>*>& run : runs) {
+            segment_count += run.size();
+        }
+        packed.reserve(segment_count);
+
+        for (std::vector<Segment<T>*>& run : runs) {
+            for (Segment<T>* segment : run) {
+                while (!segment->IsEmpty()) {
+                    Segment<T>* last = packed.empty() ? nullptr : packed.back();
+
+                    if (!last || last->back_size == last->capacity) {
+                        last = add_segment(packed, 0);
+                    }
+                    last->items[last->back_size++] = std::move(segment->items[segment->front_offset++]);
+                }
+                recycle(segment, 0);
             }
         }
 
-        return segment_idx < container->GetSegmentCount();
+        segments.Reserve(packed.size());
+        for (Segment<T>* segment : packed) {
+            segments.PushBack(segment);
+        }
+    }
+
+    // An empty deque still keeps one segment in its directory.
+    if (segments.IsEmpty()) {
+        std::vector<Segment<T>*> first;
+        first.reserve(1);
+        segments.PushBack(add_segment(first, 0));
     }
 
-    T& Get() override {
-        if (!started || segment_idx >= container->GetSegmentCount()) {
-            throw std::out_of_range("Iterator out of range");
+    for (Segment<T>*& pool : pools) {
+        while (pool) {
+            Segment<T>* next_segment = pool->next_spare;
+            pool->next_spare = nullptr;
+            ReleaseSegment(pool);
+            pool = next_segment;
         }
+    }
 
-        Segment<T>* segment = container->GetSegment(segment_idx);
-        return segment->Get(pos_in_segment);
+    if (error) {
+        std::rethrow_exception(error);
     }
+}
 
-private:
-    SegmentDeque<T>* container;
-    size_t segment_idx;
-    size_t pos_in_segment;
-    bool started;
+template <typename T, size_t InlineCapacity = DefaultInlineCapacity<T>()>
+class ConstDequeIterator : public IteratorAdapter<typename SegmentDeque<T, InlineCapacity>::ConstElementIterator, T> {
+public:
+    explicit ConstDequeIterator(const SegmentDeque<T, InlineCapacity>* deque)
+        : IteratorAdapter<typename SegmentDeque<T, InlineCapacity>::ConstElementIterator, T>(deque->begin(), deque->end()) {}
 };
 
-template <typename T>
-Iterator<T>* SegmentDeque<T>::GetIterator() const {
-    return new ConstDequeIterator<T>(this);
+template <typename T, size_t InlineCapacity = DefaultInlineCapacity<T>()>
+class MutableDequeIterator : public IteratorAdapter<typename SegmentDeque<T, InlineCapacity>::MutableElementIterator, T> {
+public:
+    explicit MutableDequeIterator(SegmentDeque<T, InlineCapacity>* deque)
+        : IteratorAdapter<typename SegmentDeque<T, InlineCapacity>::MutableElementIterator, T>(deque->begin(), deque->end()) {}
+};
+
+template <typename T, size_t InlineCapacity>
+Iterator<T>* SegmentDeque<T, InlineCapacity>::GetIterator() const {
+    return new ConstDequeIterator<T, InlineCapacity>(this);
 }
 
-template <typename T>
-Iterator<T>* SegmentDeque<T>::GetMutableIterator() {
-    return new MutableDequeIterator<T>(this);
+template <typename T, size_t InlineCapacity>
+Iterator<T>* SegmentDeque<T, InlineCapacity>::GetMutableIterator() {
+    return new MutableDequeIterator<T, InlineCapacity>(this);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,304 @@
+#ifndef SUMMARIZEDSEGMENTDEQUE_HPP
+#define SUMMARIZEDSEGMENTDEQUE_HPP
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "SegmentDeque.hpp"
+#include "lib/Monoid.hpp"
+#include "lib/RingBuffer.hpp"
+
+// SegmentDeque that keeps a Monoid summary of every segment. Appends and prepends fold the
+// new element into the end summary; pops and Set only mark a segment dirty, and dirty
+// segments are rescanned on the next query. RangeReduce combines whole-segment summaries
+// and scans only the two boundary segments.
+template <typename T, typename Monoid, size_t InlineCapacity = DefaultInlineCapacity<T>()>
+class SummarizedSegmentDeque {
+public:
+    using Value = typename Monoid::Value;
+
+    explicit SummarizedSegmentDeque(size_t segment_capacity = 16);
+    SummarizedSegmentDeque(const SummarizedSegmentDeque& deque);
+    SummarizedSegmentDeque(SummarizedSegmentDeque&& deque);
+
+    SummarizedSegmentDeque& operator=(const SummarizedSegmentDeque& deque);
+    SummarizedSegmentDeque& operator=(SummarizedSegmentDeque&& deque);
+
+    void Append(const T& value);
+    void Prepend(const T& value);
+    void PopBack();
+    void PopFront();
+    void PopBack(size_t count);
+    void PopFront(size_t count);
+    void Set(size_t index, const T& value);
+    void Clear();
+
+    const T& Get(size_t index) const;
+    size_t GetSize() const;
+    bool IsEmpty() const;
+    const SegmentDeque<T, InlineCapacity>& GetDeque() const;
+
+    // Summary of the whole deque and of the half-open index range [begin, end).
+    Value Reduce() const;
+    Value RangeReduce(size_t begin, size_t end) const;
+
+    size_t GetDirtySegmentCount() const;
+private:
+    struct Summary {
+        Value value;
+        bool dirty;
+    };
+
+    SegmentDeque<T, InlineCapacity> deque;
+    mutable RingBuffer<Summary> summaries;
+
+    void Rebuild();
+    const Value& GetSummary(size_t segment) const;
+    Value Scan(size_t segment, size_t from, size_t to) const;
+};
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+SummarizedSegmentDeque<T, Monoid, InlineCapacity>::SummarizedSegmentDeque(size_t segment_capacity)
+    : deque(segment_capacity) {
+    Rebuild();
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+SummarizedSegmentDeque<T, Monoid, InlineCapacity>::SummarizedSegmentDeque(const SummarizedSegmentDeque& deque)
+    : deque(deque.deque) {
+    Rebuild();
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+SummarizedSegmentDeque<T, Monoid, InlineCapacity>& SummarizedSegmentDeque<T, Monoid, InlineCapacity>::operator=(const SummarizedSegmentDeque& deque) {
+    if (this != &deque) {
+        this->deque = deque.deque;
+        Rebuild();
+    }
+
+    return *this;
+}
+
+// The source is left empty but usable, like a moved-from SegmentDeque: its fresh segment
+// gets a summary slot again.
+template <typename T, typename Monoid, size_t InlineCapacity>
+SummarizedSegmentDeque<T, Monoid, InlineCapacity>::SummarizedSegmentDeque(SummarizedSegmentDeque&& deque)
+    : deque(std::move(deque.deque)), summaries(std::move(deque.summaries)) {
+    deque.Rebuild();
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+SummarizedSegmentDeque<T, Monoid, InlineCapacity>& SummarizedSegmentDeque<T, Monoid, InlineCapacity>::operator=(SummarizedSegmentDeque&& deque) {
+    if (this != &deque) {
+        this->deque = std::move(deque.deque);
+        summaries = std::move(deque.summaries);
+        deque.Rebuild();
+    }
+
+    return *this;
+}
+
+// A copy does not keep the segment layout of its source, so summaries start over as dirty.
+template <typename T, typename Monoid, size_t InlineCapacity>
+void SummarizedSegmentDeque<T, Monoid, InlineCapacity>::Rebuild() {
+    summaries.Clear();
+    summaries.Reserve(deque.GetSegmentCount());
+
+    for (size_t i = 0; i < deque.GetSegmentCount(); i++) {
+        summaries.PushBack(Summary{Monoid::Identity(), true});
+    }
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+void SummarizedSegmentDeque<T, Monoid, InlineCapacity>::Append(const T& value) {
+    bool was_inline = deque.IsInline();
+    size_t segment_count = deque.GetSegmentCount();
+
+    deque.Append(value);
+
+    if (was_inline != deque.IsInline()) {
+        Rebuild();
+    } else if (deque.GetSegmentCount() > segment_count) {
+        summaries.PushBack(Summary{Monoid::Lift(value), false});
+    } else {
+        Summary& last = summaries[summaries.GetSize() - 1];
+        if (!last.dirty) {
+            last.value = Monoid::Combine(last.value, Monoid::Lift(value));
+        }
+    }
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+void SummarizedSegmentDeque<T, Monoid, InlineCapacity>::Prepend(const T& value) {
+    bool was_inline = deque.IsInline();
+    size_t segment_count = deque.GetSegmentCount();
+
+    deque.Prepend(value);
+
+    if (was_inline != deque.IsInline()) {
+        Rebuild();
+    } else if (deque.GetSegmentCount() > segment_count) {
+        summaries.PushFront(Summary{Monoid::Lift(value), false});
+    } else {
+        Summary& first = summaries[0];
+        if (!first.dirty) {
+            first.value = Monoid::Combine(Monoid::Lift(value), first.value);
+        }
+    }
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+void SummarizedSegmentDeque<T, Monoid, InlineCapacity>::PopBack() {
+    if (deque.IsEmpty()) {
+        throw std::out_of_range("PopBack from empty deque");
+    }
+
+    PopBack(1);
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+void SummarizedSegmentDeque<T, Monoid, InlineCapacity>::PopFront() {
+    if (deque.IsEmpty()) {
+        throw std::out_of_range("PopFront from empty deque");
+    }
+
+    PopFront(1);
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+void SummarizedSegmentDeque<T, Monoid, InlineCapacity>::PopBack(size_t count) {
+    deque.PopBack(count);
+
+    while (summaries.GetSize() > deque.GetSegmentCount()) {
+        summaries.PopBack();
+    }
+
+    summaries[summaries.GetSize() - 1].dirty = true;
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+void SummarizedSegmentDeque<T, Monoid, InlineCapacity>::PopFront(size_t count) {
+    deque.PopFront(count);
+
+    while (summaries.GetSize() > deque.GetSegmentCount()) {
+        summaries.PopFront();
+    }
+
+    summaries[0].dirty = true;
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+void SummarizedSegmentDeque<T, Monoid, InlineCapacity>::Set(size_t index, const T& value) {
+    deque.Get(index) = value;
+    summaries[deque.GetSegmentIndex(index)].dirty = true;
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+void SummarizedSegmentDeque<T, Monoid, InlineCapacity>::Clear() {
+    deque.Clear();
+    Rebuild();
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+const T& SummarizedSegmentDeque<T, Monoid, InlineCapacity>::Get(size_t index) const {
+    return deque.Get(index);
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+size_t SummarizedSegmentDeque<T, Monoid, InlineCapacity>::GetSize() const {
+    return deque.GetSize();
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+bool SummarizedSegmentDeque<T, Monoid, InlineCapacity>::IsEmpty() const {
+    return deque.IsEmpty();
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+const SegmentDeque<T, InlineCapacity>& SummarizedSegmentDeque<T, Monoid, InlineCapacity>::GetDeque() const {
+    return deque;
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+size_t SummarizedSegmentDeque<T, Monoid, InlineCapacity>::GetDirtySegmentCount() const {
+    size_t count = 0;
+
+    for (size_t i = 0; i < summaries.GetSize(); i++) {
+        count += summaries[i].dirty ? 1 : 0;
+    }
+
+    return count;
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+typename Monoid::Value SummarizedSegmentDeque<T, Monoid, InlineCapacity>::Scan(size_t segment, size_t from, size_t to) const {
+    const Segment<T>* data = deque.GetSegment(segment);
+    Value result = Monoid::Identity();
+
+    for (size_t i = from; i < to; i++) {
+        result = Monoid::Combine(result, Monoid::Lift((*data)[i]));
+    }
+
+    return result;
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+const typename Monoid::Value& SummarizedSegmentDeque<T, Monoid, InlineCapacity>::GetSummary(size_t segment) const {
+    Summary& summary = summaries[segment];
+
+    if (summary.dirty) {
+        summary.value = Scan(segment, 0, deque.GetSegment(segment)->GetEffectiveSize());
+        summary.dirty = false;
+    }
+
+    return summary.value;
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+typename Monoid::Value SummarizedSegmentDeque<T, Monoid, InlineCapacity>::Reduce() const {
+    Value result = Monoid::Identity();
+
+    for (size_t i = 0; i < summaries.GetSize(); i++) {
+        result = Monoid::Combine(result, GetSummary(i));
+    }
+
+    return result;
+}
+
+template <typename T, typename Monoid, size_t InlineCapacity>
+typename Monoid::Value SummarizedSegmentDeque<T, Monoid, InlineCapacity>::RangeReduce(size_t begin, size_t end) const {
+    if (begin > end || end > deque.GetSize()) {
+        throw std::out_of_range("Range [" + std::to_string(begin) + ", " + std::to_string(end) +
+                                ") is out of range for deque of size " + std::to_string(deque.GetSize()));
+    }
+
+    if (begin == end) {
+        return Monoid::Identity();
+    }
+
+    size_t first = deque.GetSegmentIndex(begin);
+    size_t last = deque.GetSegmentIndex(end - 1);
+    size_t first_offset = begin - deque.GetSegmentStart(first);
+    size_t last_offset = end - deque.GetSegmentStart(last);
+
+    if (first == last) {
+        if (first_offset == 0 && last_offset == deque.GetSegment(last)->GetEffectiveSize()) {
+            return GetSummary(first);
+        }
+        return Scan(first, first_offset, last_offset);
+    }
+
+    Value result = first_offset == 0 ? GetSummary(first)
+                                     : Scan(first, first_offset, deque.GetSegment(first)->GetEffectiveSize());
+
+    for (size_t i = first + 1; i < last; i++) {
+        result = Monoid::Combine(result, GetSummary(i));
+    }
+
+    if (last_offset == deque.GetSegment(last)->GetEffectiveSize()) {
+        return Monoid::Combine(result, GetSummary(last));
+    }
+    return Monoid::Combine(result, Scan(last, 0, last_offset));
+}
+
+#endif
@@ -1,12 +1,32 @@
 #ifndef TESTS_HPP
 #define TESTS_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <cassert>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <sstream>
 #include <vector>
 #include <string>
+#include <thread>
 #include <stdexcept>
 #include "SegmentDeque.hpp"
+#include "DequeIO.hpp"
+#include "SummarizedSegmentDeque.hpp"
+#include "WindowedSegmentDeque.hpp"
+#include "AsyncSegmentDeque.hpp"
+#include "ConcurrentSegmentDeque.hpp"
+#include "BoundedSegmentQueue.hpp"
+#include "lib/UnrolledListSequence.hpp"
 
 class Tests {
 public:
@@ -25,9 +45,145 @@ public:
         TestLargeOperations();
         TestExceptions();
         TestWithStrings();
+        TestImmutableArraySequence();
+        TestListSequenceAccess();
+        TestLinkedListNodeReuse();
+        TestUnrolledListSequence();
+        TestCheckedAccess();
+        TestStaticInterfaces();
+        TestBulkPop();
+        TestReserve();
+        TestInlineStorage();
+        TestSort();
+        TestBinarySearch();
+        TestSegmentSummaries();
+        TestWindowedAggregates();
+        TestLoadSave();
+        TestWriteTo();
+        TestStreamingFlatMap();
+        TestWhereCompaction();
+        TestInPlaceTransforms();
+        TestMemoryUsage();
+        TestSegmentLayout();
+        TestLayoutChanges();
+        TestConcurrentDeque();
+        TestBoundedQueue();
+#ifdef __cpp_impl_coroutine
+        TestCoroutines();
+#endif
         std::cout << "All tests passed\n";
     }
 
+    // Complexity regression checks, kept out of RunAllTests because they are slow and timing-based.
+    // Every operation is timed at doubling sizes; a failure throws std::runtime_error.
+    static void RunScalabilityTests() {
+        std::cout << "Running scalability tests\n";
+
+        CheckScaling("SegmentDeque::Append", 1.0, [](size_t n) {
+            SegmentDeque<int> deque;
+            for (size_t i = 0; i < n; i++) {
+                deque.Append(static_cast<int>(i));
+            }
+            return deque.GetSize();
+        });
+        CheckScaling("SegmentDeque::Prepend", 1.0, [](size_t n) {
+            SegmentDeque<int> deque;
+            for (size_t i = 0; i < n; i++) {
+                deque.Prepend(static_cast<int>(i));
+            }
+            return deque.GetSize();
+        });
+        CheckScaling("SegmentDeque::PopBack/PopFront", 1.0, [](size_t n) {
+            SegmentDeque<int> deque = MakeDeque(n);
+            for (size_t i = 0; i < n / 2; i++) {
+                deque.PopBack();
+                deque.PopFront();
+            }
+            return deque.GetSize();
+        });
+        CheckScaling("SegmentDeque::Get", 1.0, [](size_t n) {
+            SegmentDeque<int> deque = MakeDeque(n);
+            size_t sum = 0;
+            for (size_t i = 0; i < n; i++) {
+                sum += deque.Get(i);
+            }
+            return sum;
+        });
+        CheckScaling("SegmentDeque iteration", 1.0, [](size_t n) {
+            SegmentDeque<int> deque = MakeDeque(n);
+            size_t sum = 0;
+            for (int value : deque) {
+                sum += value;
+            }
+            Iterator<int>* iterator = deque.GetIterator();
+            while (iterator->Next()) {
+                sum += iterator->Get();
+            }
+            delete iterator;
+            return sum;
+        });
+        CheckScaling("SegmentDeque::Map", 1.0, [](size_t n) {
+            return MakeDeque(n).Map([](int x) { return x * 2; }).GetSize();
+        });
+        CheckScaling("SegmentDeque::Where", 1.0, [](size_t n) {
+            return MakeDeque(n).Where([](int x) { return x % 3 == 0; }).GetSize();
+        });
+        CheckScaling("SegmentDeque::Reduce", 1.0, [](size_t n) {
+            return static_cast<size_t>(MakeDeque(n).Reduce([](int acc, int x) { return acc ^ x; }, 0));
+        });
+        // A node per element: smaller sizes keep cache misses from skewing the fit.
+        CheckScaling("ListSequence::Append/Prepend", 1.0, [](size_t n) {
+            ListSequence<int> sequence;
+            for (size_t i = 0; i < n / 2; i++) {
+                sequence.Append(static_cast<int>(i));
+                sequence.Prepend(static_cast<int>(i));
+            }
+            return sequence.GetSize();
+        }, 1 << 12);
+        CheckScaling("ListSequence::Concat", 1.0, [](size_t n) {
+            ListSequence<int> first;
+            ListSequence<int> second;
+            for (size_t i = 0; i < n / 2; i++) {
+                first.Append(static_cast<int>(i));
+                second.Append(static_cast<int>(i));
+            }
+            ListSequence<int>* concat = first.Concat(&second);
+            size_t size = concat->GetSize();
+            delete concat;
+            return size;
+        }, 1 << 12);
+        CheckScaling("MutableArraySequence::Append", 1.0, [](size_t n) {
+            MutableArraySequence<int> sequence;
+            for (size_t i = 0; i < n; i++) {
+                sequence.Append(static_cast<int>(i));
+            }
+            return sequence.GetSize();
+        });
+        CheckScaling("MutableArraySequence::Concat", 1.0, [](size_t n) {
+            std::vector<int> values(n / 2, 1);
+            MutableArraySequence<int> first(values.data(), values.size());
+            MutableArraySequence<int> second(values.data(), values.size());
+            ArraySequence<int>* concat = first.Concat(&second);
+            size_t size = concat->GetSize();
+            delete concat;
+            return size;
+        });
+        CheckScaling("UnrolledListSequence::Append/Concat", 1.0, [](size_t n) {
+            UnrolledListSequence<int, 16> first;
+            UnrolledListSequence<int, 16> second;
+            for (size_t i = 0; i < n / 2; i++) {
+                first.Append(static_cast<int>(i));
+                second.Append(static_cast<int>(i));
+            }
+            UnrolledListSequence<int, 16>* concat = first.Concat(&second);
+            size_t size = concat->GetSize();
+            delete concat;
+            return size;
+        });
+
+        std::cout << "Scalability tests passed\n";
+    }
+
 private:
     static void TestConstructor() {
         std::cout << "Testing Constructor\n";
@@ -344,10 +500,1851 @@ private:
 
         std::cout << "String type tests passed\n";
     }
-};
 
-void RunDequeTests() {
-    Tests::RunAllTests();
+    static void TestImmutableArraySequence() {
+        std::cout << "Testing ImmutableArraySequence\n";
+
+        ImmutableArraySequence<int> sequence;
+        std::vector<int> expected;
+
+        for (int i = 0; i < 500; i++) {
+            sequence.Append(i);
+            expected.push_back(i);
+        }
+
+        for (int i = 0; i < 100; i++) {
+            sequence.Prepend(-i);
+            expected.insert(expected.begin(), -i);
+        }
+
+        for (int i = 0; i < 100; i++) {
+            size_t index = (i * 37) % (expected.size() + 1);
+            sequence.InsertAt(1000 + i, index);
+            expected.insert(expected.begin() + index, 1000 + i);
+        }
+
+        assert(sequence.GetSize() == expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            assert(sequence.Get(i) == expected[i]);
+        }
+
+        ImmutableArraySequence<int> snapshot = sequence;
+        sequence.Set(-1, 10);
+        sequence.Set(-2, 20);
+        sequence.Append(7);
+
+        assert(sequence.Get(10) == -1 && sequence.Get(20) == -2 && sequence.GetLast() == 7);
+        assert(snapshot.GetSize() == expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            assert(snapshot.Get(i) == expected[i]);
+        }
+
+        ImmutableArraySequence<int>* sub = snapshot.GetSubsequence(50, 149);
+        assert(sub->GetSize() == 100);
+        for (size_t i = 0; i < 100; i++) {
+            assert(sub->Get(i) == expected[50 + i]);
+        }
+
+        ImmutableArraySequence<int>* concat = sub->Concat(&snapshot);
+        assert(concat->GetSize() == 100 + expected.size());
+        assert(concat->Get(99) == expected[149] && concat->Get(100) == expected[0]);
+        assert(concat->GetLast() == expected.back());
+
+        delete concat;
+        delete sub;
+
+        try {
+            snapshot.Get(expected.size());
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        std::cout << "ImmutableArraySequence tests passed\n";
+    }
+
+    static void TestListSequenceAccess() {
+        std::cout << "Testing ListSequence access\n";
+
+        ListSequence<int> list;
+        for (int i = 0; i < 100; i++) {
+            list.Append(i);
+        }
+
+        for (size_t i = 0; i < list.GetSize(); i++) {
+            assert(list.Get(i) == static_cast<int>(i));
+        }
+
+        for (size_t i = list.GetSize(); i > 0; i--) {
+            assert(list.Get(i - 1) == static_cast<int>(i - 1));
+        }
+
+        list.Get(50);
+        list.Prepend(-1);
+        list.InsertAt(-2, 60);
+        list.RemoveNode(30);
+        assert(list.Get(0) == -1 && list.Get(1) == 0 && list.Get(29) == 28 && list.Get(30) == 30);
+        assert(list.Get(58) == 58 && list.Get(59) == -2 && list.Get(60) == 59);
+
+        list.InsertAt(-3, 95);
+        assert(list.Get(94) == 93 && list.Get(95) == -3 && list.Get(96) == 94);
+
+        size_t count = 0;
+        for ([[maybe_unused]] int value : list) {
+            assert(value == list.Get(count));
+            count++;
+        }
+        assert(count == list.GetSize());
+
+        ListSequence<int>* sub = list.GetSubsequence(1, 10);
+        assert(sub->GetSize() == 10 && sub->GetFirst() == 0 && sub->GetLast() == 9);
+        delete sub;
+
+        std::cout << "ListSequence access tests passed\n";
+    }
+
+    static void TestLinkedListNodeReuse() {
+        std::cout << "Testing LinkedList node reuse\n";
+
+        LinkedList<std::string> list;
+        for (int i = 0; i < 200; i++) {
+            list.Append(std::to_string(i));
+        }
+
+        for (int i = 0; i < 100; i++) {
+            list.RemoveNode(0);
+        }
+
+        for (int i = 0; i < 100; i++) {
+            list.Prepend(std::to_string(-i));
+        }
+
+        assert(list.GetSize() == 200 && list.GetFirst() == "-99" && list.Get(100) == "100");
+
+        LinkedList<std::string> copy(list);
+        LinkedList<std::string> assigned;
+        assigned.Append("x");
+        assigned = copy;
+        assert(assigned.GetSize() == 200 && assigned.GetLast() == "199");
+
+        LinkedList<std::string> moved;
+        moved = std::move(assigned);
+        moved.Append("tail");
+        assert(moved.GetSize() == 201 && moved.GetLast() == "tail" && copy.GetSize() == 200);
+
+        std::cout << "LinkedList node reuse tests passed\n";
+    }
+
+    static void TestUnrolledListSequence() {
+        std::cout << "Testing UnrolledListSequence\n";
+
+        UnrolledListSequence<int, 4> sequence;
+        std::vector<int> expected;
+
+        for (int i = 0; i < 300; i++) {
+            size_t index = (i * 7919) % (expected.size() + 1);
+
+            if (i % 3 == 0) {
+                sequence.Append(i);
+                expected.push_back(i);
+            } else if (i % 3 == 1) {
+                sequence.Prepend(i);
+                expected.insert(expected.begin(), i);
+            } else {
+                sequence.InsertAt(i, index);
+                expected.insert(expected.begin() + index, i);
+            }
+        }
+
+        for (int i = 0; i < 150; i++) {
+            size_t index = (i * 104729) % expected.size();
+            sequence.RemoveNode(index);
+            expected.erase(expected.begin() + index);
+        }
+
+        assert(sequence.GetSize() == expected.size());
+        assert(sequence.GetFirst() == expected.front() && sequence.GetLast() == expected.back());
+        for (size_t i = 0; i < expected.size(); i++) {
+            assert(sequence.Get(i) == expected[i]);
+        }
+        for (size_t i = expected.size(); i-- > 0;) {
+            assert(sequence.Get(i) == expected[i]);
+        }
+        assert(sequence.GetNodeCount() <= expected.size() / 2 + 1);
+
+        [[maybe_unused]] size_t position = 0;
+        for ([[maybe_unused]] int value : sequence) {
+            assert(value == expected[position++]);
+        }
+
+        UnrolledListSequence<int, 4>* sub = sequence.GetSubsequence(10, 29);
+        assert(sub->GetSize() == 20 && sub->GetFirst() == expected[10] && sub->GetLast() == expected[29]);
+
+        ListSequence<int> list;
+        list.Append(-5);
+        UnrolledListSequence<int, 4>* concat = sub->Concat(&list);
+        assert(concat->GetSize() == 21 && concat->GetLast() == -5);
+
+        delete concat;
+        delete sub;
+
+        try {
+            sequence.Get(expected.size());
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        std::cout << "UnrolledListSequence tests passed\n";
+    }
+
+    static void TestCheckedAccess() {
+        std::cout << "Testing checked and unchecked access\n";
+
+        SegmentDeque<int> deque(4);
+        MutableArraySequence<int> array;
+        for (int i = 0; i < 10; i++) {
+            deque.Append(i);
+            array.Append(i);
+        }
+
+        for (size_t i = 0; i < 10; i++) {
+            assert(deque[i] == deque.At(i) && array[i] == array.At(i));
+        }
+
+        deque[3] = 30;
+        array[3] = 30;
+        assert(deque.Get(3) == 30 && array.Get(3) == 30);
+
+        try {
+            deque.At(10);
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        try {
+            array.At(10);
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        // Shrinking keeps the capacity; growing back value-initializes the reused slots.
+        DynamicArray<int> grown(4);
+        grown.Reserve(16);
+        grown.Set(7, 3);
+        grown.Resize(2);
+        grown.Resize(4);
+        assert(grown.GetCapacity() == 16 && grown.GetSize() == 4 && grown.Get(3) == 0);
+
+#ifndef NDEBUG
+        try {
+            deque[10];
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        try {
+            array[10];
+            assert(false);
+        } catch (const std::out_of_range&) {}
+#endif
+
+        std::cout << "Checked and unchecked access tests passed\n";
+    }
+
+    static void TestStaticInterfaces() {
+        std::cout << "Testing static interfaces\n";
+
+        DynamicArray<int> array(5);
+        for (size_t i = 0; i < array.GetSize(); i++) {
+            array[i] = static_cast<int>(i) + 1;
+        }
+        assert(array.GetFirst() == 1 && array.GetLast() == 5 && !array.IsEmpty());
+        assert(array.Reduce([](long long acc, int x) { return acc + x; }, 0LL) == 15);
+
+        SegmentDeque<int> deque(3);
+        for (int i = 0; i < 10; i++) {
+            deque.Append(i);
+            deque.Prepend(-i - 1);
+        }
+
+        int index = 0;
+        for ([[maybe_unused]] int value : deque) {
+            assert(value == deque.Get(index));
+            index++;
+        }
+        assert(index == 20);
+
+        deque.ForEach([](int& value) { value *= 2; });
+        assert(deque.Get(0) == -20 && deque.Get(19) == 18);
+
+        const SegmentDeque<int>& const_deque = deque;
+        long long sum = 0;
+        const_deque.ForEach([&](const int& value) { sum += value; });
+        assert(sum == -20);
+        assert(const_deque.CountIf([](int x) { return x > 0; }) == 9);
+
+        SegmentDeque<int> empty_deque;
+        assert(empty_deque.begin() == empty_deque.end());
+
+        std::cout << "Static interfaces tests passed\n";
+    }
+
+    static void TestBulkPop() {
+        std::cout << "Testing bulk PopFront/PopBack/DrainFront\n";
+
+        SegmentDeque<int> deque(4);
+        for (int i = 0; i < 50; i++) {
+            deque.Append(i);
+        }
+        deque.Prepend(-1);
+        deque.Prepend(-2);
+
+        deque.PopFront(7);
+        assert(deque.GetSize() == 45 && deque.Get(0) == 5);
+
+        deque.PopBack(10);
+        assert(deque.GetSize() == 35 && deque.Get(34) == 39);
+        assert(deque.GetSegmentCount() <= 35 / 4 + 2);
+
+        std::vector<int> drained;
+        [[maybe_unused]] size_t count = deque.DrainFront(std::back_inserter(drained), 13);
+        assert(count == 13 && drained.size() == 13);
+        for (int i = 0; i < 13; i++) {
+            assert(drained[i] == 5 + i);
+        }
+        assert(deque.GetSize() == 22 && deque.Get(0) == 18);
+
+        try {
+            deque.PopFront(23);
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        count = deque.DrainFront(std::back_inserter(drained), 100);
+        assert(count == 22 && deque.IsEmpty() && drained.back() == 39);
+        assert(deque.GetSegmentCount() == 1);
+
+        for (int i = 0; i < 10; i++) {
+            deque.Append(i);
+            deque.Prepend(-i);
+        }
+        deque.PopBack(20);
+        assert(deque.IsEmpty());
+
+        deque.Append(1);
+        deque.Prepend(0);
+        assert(deque.GetSize() == 2 && deque.Get(0) == 0 && deque.Get(1) == 1);
+
+        std::cout << "Bulk pop tests passed\n";
+    }
+
+    static void TestReserve() {
+        std::cout << "Testing Reserve\n";
+
+        SegmentDeque<int> deque(4);
+        deque.Append(0);
+
+        deque.ReserveBack(99);
+        assert(deque.GetSpareSegmentCount() == 24);
+
+        for (int i = 1; i < 100; i++) {
+            deque.Append(i);
+        }
+        assert(deque.GetSpareSegmentCount() == 0 && deque.GetSegmentCount() == 25);
+        for (size_t i = 2; i < deque.GetSegmentCount(); i++) {
+            assert(deque.GetSegment(i)->block && deque.GetSegment(i)->block == deque.GetSegment(1)->block);
+        }
+
+        deque.Reserve(10, 6);
+        assert(deque.GetSpareSegmentCount() == 5);
+
+        for (int i = 0; i < 10; i++) {
+            deque.Prepend(-i - 1);
+        }
+        for (int i = 100; i < 106; i++) {
+            deque.Append(i);
+        }
+        assert(deque.GetSpareSegmentCount() == 0);
+
+        assert(deque.GetSize() == 116 && deque.Get(0) == -10 && deque.Get(10) == 0 && deque.Get(115) == 105);
+
+        deque.ReserveFront(3);
+        assert(deque.GetSpareSegmentCount() == 1);
+
+        // Resize grows with value-initialized elements and shrinks from the back.
+        deque.Resize(130);
+        assert(deque.GetSize() == 130 && deque.Get(115) == 105 && deque.Get(116) == 0 && deque.Get(129) == 0);
+        deque[129] = 7;
+        deque.Resize(117);
+        assert(deque.GetSize() == 117 && deque.Get(116) == 0);
+        deque.Resize(200);
+        assert(deque.Get(199) == 0 && deque.Get(129) == 0);
+
+        SegmentDeque<std::string> strings;
+        strings.Resize(3);
+        assert(strings.GetSize() == 3 && strings.IsInline() && strings.Get(2).empty());
+        strings.Resize(100);
+        strings.Resize(0);
+        assert(strings.IsEmpty());
+
+        std::cout << "Reserve tests passed\n";
+    }
+    static void TestInlineStorage() {
+        std::cout << "Testing inline storage\n";
+
+        SegmentDeque<int, 8> deque(4);
+        assert(deque.IsInline() && deque.GetSegmentCount() == 1);
+
+        for (int i = 0; i < 4; i++) {
+            deque.Append(i);
+        }
+        for (int i = 0; i < 100; i++) {
+            deque.PopFront();
+            deque.Append(i + 4);
+        }
+        assert(deque.IsInline() && deque.GetSize() == 4 && deque.Get(0) == 100);
+
+        for (int i = 0; i < 100; i++) {
+            deque.PopBack();
+            deque.Prepend(-i);
+        }
+        assert(deque.IsInline() && deque.GetSegment(0)->capacity == 8);
+        assert(deque.Get(0) == -99 && deque.Get(3) == -96);
+
+        deque.PopFront(4);
+        for (int i = 0; i < 9; i++) {
+            deque.Append(i);
+        }
+        assert(!deque.IsInline() && deque.GetSize() == 9);
+        for (size_t i = 0; i < deque.GetSegmentCount(); i++) {
+            assert(deque.GetSegment(i)->capacity == 4);
+        }
+        for (int i = 0; i < 9; i++) {
+            assert(deque.Get(i) == i);
+        }
+
+        SegmentDeque<int, 8> copy(deque);
+        SegmentDeque<int, 8> moved(std::move(copy));
+        assert(moved.GetSize() == 9 && moved.Get(8) == 8);
+        assert(copy.IsEmpty() && copy.IsInline());
+        copy.Append(1);
+        assert(copy.GetSize() == 1 && copy.Get(0) == 1);
+
+        SegmentDeque<int, 8> small(4);
+        small.Prepend(2);
+        small.Prepend(1);
+        moved = std::move(small);
+        assert(moved.IsInline() && moved.GetSize() == 2 && moved.Get(0) == 1 && moved.Get(1) == 2);
+        moved = deque;
+        assert(moved.GetSize() == 9 && moved.Get(4) == 4 && deque.GetSize() == 9);
+
+        deque.Clear();
+        assert(deque.IsEmpty() && deque.IsInline() && deque.GetSpareSegmentCount() == 0);
+        for (int i = 0; i < 9; i++) {
+            deque.Append(i);
+        }
+        deque.SetSpareLimit(2);
+        deque.Clear();
+        assert(deque.IsEmpty() && deque.IsInline() && deque.GetSpareSegmentCount() == 2);
+        assert(deque.MemoryUsage().slack_bytes == (8 + 2 * 4) * sizeof(int));
+        assert(deque.MemoryUsage().metadata_bytes == sizeof(deque) - 8 * sizeof(int) + 2 * sizeof(Segment<int>));
+
+        // Assigning across segment capacities must not reuse segments of the old capacity.
+        SegmentDeque<int> narrow(4);
+        SegmentDeque<int> wide(16);
+        SegmentDeque<int, 0> narrow_heap(4);
+        SegmentDeque<int, 0> wide_heap(16);
+        for (int i = 0; i < 100; i++) {
+            narrow.Append(i);
+            wide.Append(-i);
+            narrow_heap.Append(i);
+            wide_heap.Append(-i);
+        }
+        narrow = wide;
+        narrow_heap = wide_heap;
+        assert(narrow.GetSegmentCapacity() == 16 && narrow_heap.GetSegmentCapacity() == 16);
+        for (int i = 0; i < 100; i++) {
+            assert(narrow.Get(i) == -i && narrow_heap.Get(i) == -i);
+        }
+        for (size_t i = 0; i < narrow.GetSegmentCount(); i++) {
+            assert(narrow.GetSegment(i)->capacity == 16);
+        }
+        for (size_t i = 0; i < narrow_heap.GetSegmentCount(); i++) {
+            assert(narrow_heap.GetSegment(i)->capacity == 16);
+        }
+        wide = SegmentDeque<int>(4);
+        wide = narrow_heap.Map([](int x) { return x; });
+        assert(wide.GetSize() == 100 && wide.Get(99) == -99);
+
+        SegmentDeque<int, 0> heap_only(4);
+        assert(!heap_only.IsInline());
+        for (int i = 0; i < 10; i++) {
+            heap_only.Prepend(i);
+        }
+        SegmentDeque<int, 0> heap_copy = heap_only;
+        assert(heap_copy.GetSize() == 10 && heap_copy.Get(0) == 9);
+
+        SegmentDeque<std::string> strings;
+        for (int i = 0; i < 40; i++) {
+            strings.Append(std::to_string(i));
+        }
+        SegmentDeque<std::string> mapped = strings.Map([](const std::string& s) { return s + "!"; });
+        assert(mapped.GetSize() == 40 && mapped.Get(39) == "39!");
+
+        std::cout << "Inline storage tests passed\n";
+    }
+    static void TestSort() {
+        std::cout << "Testing Sort/StableSort\n";
+
+        SegmentDeque<int> small;
+        for (int value : {5, 3, 9, 1, 7}) {
+            small.Prepend(value);
+        }
+        small.Sort();
+        assert(small.Get(0) == 1 && small.Get(2) == 5 && small.Get(4) == 9);
+
+        const int COUNT = 200000;
+        SegmentDeque<int> deque(100);
+        unsigned int state = 12345;
+        long long checksum = 0;
+        for (int i = 0; i < COUNT; i++) {
+            state = state * 1103515245u + 12345u;
+            int value = static_cast<int>(state >> 8) % 1000;
+            checksum += value;
+            i % 2 ? deque.Append(value) : deque.Prepend(value);
+        }
+
+        // Packing frees the segment left over at the tail; with no spare limit it is not kept.
+        assert(deque.GetSegmentCount() > COUNT / 100);
+        deque.Sort();
+        assert(deque.GetSize() == COUNT && deque.GetSegmentCount() == COUNT / 100);
+        assert(deque.GetSpareSegmentCount() == 0);
+        long long sorted_checksum = 0;
+        [[maybe_unused]] int previous_value = 0;
+        for (int value : deque) {
+            assert(previous_value <= value);
+            previous_value = value;
+            sorted_checksum += value;
+        }
+        assert(sorted_checksum == checksum);
+
+        deque.Sort([](int a, int b) { return a > b; });
+        assert(deque.Get(0) == 999 && deque.Get(COUNT - 1) == 0);
+
+        SegmentDeque<std::pair<int, int>> pairs(7);
+        for (int i = 0; i < COUNT; i++) {
+            pairs.Append(std::make_pair((i * 7919) % 10, i));
+        }
+        pairs.StableSort([](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first < b.first; });
+        std::pair<int, int> previous(-1, -1);
+        for (const std::pair<int, int>& current : pairs) {
+            assert(previous.first < current.first || (previous.first == current.first && previous.second < current.second));
+            previous = current;
+        }
+
+        std::atomic<int> comparisons(0);
+        try {
+            deque.Sort([&](int a, int b) {
+                if (++comparisons > COUNT) {
+                    throw std::runtime_error("comparator failed");
+                }
+                return a < b;
+            });
+            assert(false);
+        } catch (const std::runtime_error&) {}
+        assert(deque.GetSize() == COUNT && deque.Reduce([](int acc, int x) { return acc + x; }, 0) == sorted_checksum);
+
+        // A comparator that fails during the merge passes, after the first runs are sorted,
+        // leaves every element in the deque. A dry run on equal data counts the comparisons.
+        auto fill = [](SegmentDeque<int>& target) {
+            for (int i = 0; i < 100000; i++) {
+                target.Append((i * 7919) % 100000);
+            }
+        };
+        SegmentDeque<int> counted(64);
+        fill(counted);
+        comparisons = 0;
+        counted.Sort([&](int a, int b) {
+            ++comparisons;
+            return a < b;
+        });
+        int limit = comparisons - 50000;
+
+        SegmentDeque<int> failing(64);
+        fill(failing);
+        comparisons = 0;
+        try {
+            failing.Sort([&](int a, int b) {
+                if (++comparisons > limit) {
+                    throw std::runtime_error("comparator failed");
+                }
+                return a < b;
+            });
+            assert(false);
+        } catch (const std::runtime_error&) {}
+        assert(failing.GetSize() == 100000 && failing.GetSegmentCount() == 100000 / 64 + 1);
+        long long failed_sum = 0;
+        failing.ForEach([&](int value) { failed_sum += value; });
+        assert(failed_sum == 99999LL * 100000 / 2);
+        failing.Sort();
+        assert(failing.Get(0) == 0 && failing.Get(99999) == 99999 && failing.Get(31415) == 31415);
+
+        std::cout << "Sort tests passed\n";
+    }
+    static void TestBinarySearch() {
+        std::cout << "Testing LowerBound/UpperBound/EqualRange\n";
+
+        SegmentDeque<int> empty_deque;
+        assert(empty_deque.LowerBound(5) == 0 && empty_deque.UpperBound(5) == 0);
+
+        SegmentDeque<int> deque(4);
+        std::vector<int> expected;
+        for (int i = 0; i < 60; i++) {
+            deque.Append(i / 3 * 2);
+            expected.push_back(i / 3 * 2);
+        }
+        for (int i = 1; i <= 7; i++) {
+            deque.Prepend(-i);
+            expected.insert(expected.begin(), -i);
+        }
+        deque.PopBack(2);
+        expected.resize(expected.size() - 2);
+
+        for (int value = -10; value <= 42; value++) {
+            [[maybe_unused]] size_t lower = std::lower_bound(expected.begin(), expected.end(), value) - expected.begin();
+            [[maybe_unused]] size_t upper = std::upper_bound(expected.begin(), expected.end(), value) - expected.begin();
+
+            assert(deque.LowerBound(value) == lower);
+            assert(deque.UpperBound(value) == upper);
+            assert(deque.EqualRange(value) == std::make_pair(lower, upper));
+        }
+
+        for (size_t i = 0; i < expected.size(); i++) {
+            assert(deque[i] == expected[i]);
+        }
+
+        SegmentDeque<int> small;
+        for (int value : {9, 7, 7, 3}) {
+            small.Append(value);
+        }
+        [[maybe_unused]] std::greater<int> descending;
+        assert(small.IsInline());
+        assert(small.LowerBound(7, descending) == 1 && small.UpperBound(7, descending) == 3);
+        assert(small.LowerBound(10, descending) == 0 && small.UpperBound(0, descending) == 4);
+
+        std::cout << "Binary search tests passed\n";
+    }
+    struct ConcatMonoid {
+        using Value = std::string;
+
+        static Value Identity() { return ""; }
+        static Value Lift(int value) { return std::to_string(value) + ","; }
+        static Value Combine(const Value& left, const Value& right) { return left + right; }
+    };
+
+    static void TestSegmentSummaries() {
+        std::cout << "Testing segment summaries and RangeReduce\n";
+
+        SummarizedSegmentDeque<int, StatsMonoid<int>, 8> deque(4);
+        SummarizedSegmentDeque<int, ConcatMonoid, 8> ordered(4);
+        std::vector<int> expected;
+        unsigned int state = 7;
+
+        for (int step = 0; step < 3000; step++) {
+            state = state * 1103515245u + 12345u;
+            int value = static_cast<int>(state >> 16) % 201 - 100;
+            unsigned int operation = (state >> 4) % 10;
+
+            if (operation < 4) {
+                deque.Append(value);
+                ordered.Append(value);
+                expected.push_back(value);
+            } else if (operation < 7) {
+                deque.Prepend(value);
+                ordered.Prepend(value);
+                expected.insert(expected.begin(), value);
+            } else if (operation == 7 && !expected.empty()) {
+                deque.PopBack();
+                ordered.PopBack();
+                expected.pop_back();
+            } else if (operation == 8 && !expected.empty()) {
+                size_t count = (state >> 8) % (expected.size() < 5 ? expected.size() + 1 : 5);
+                deque.PopFront(count);
+                ordered.PopFront(count);
+                expected.erase(expected.begin(), expected.begin() + count);
+            } else if (!expected.empty()) {
+                size_t index = (state >> 8) % expected.size();
+                deque.Set(index, value);
+                ordered.Set(index, value);
+                expected[index] = value;
+            }
+
+            if (expected.empty()) {
+                assert(deque.Reduce().count == 0);
+                continue;
+            }
+
+            size_t begin = (state >> 3) % expected.size();
+            size_t end = begin + (state >> 12) % (expected.size() - begin + 1);
+
+            [[maybe_unused]] Stats<int> stats = deque.RangeReduce(begin, end);
+            std::string concatenated;
+            int sum = 0;
+            int min = std::numeric_limits<int>::max();
+            int max = std::numeric_limits<int>::lowest();
+            for (size_t i = begin; i < end; i++) {
+                sum += expected[i];
+                min = expected[i] < min ? expected[i] : min;
+                max = expected[i] > max ? expected[i] : max;
+                concatenated += std::to_string(expected[i]) + ",";
+            }
+
+            assert(stats.count == end - begin && stats.sum == sum && stats.min == min && stats.max == max);
+            assert(ordered.RangeReduce(begin, end) == concatenated);
+            assert(deque.Reduce().count == expected.size());
+        }
+
+        try {
+            deque.RangeReduce(0, deque.GetSize() + 1);
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        SummarizedSegmentDeque<long long, SumMonoid<long long>> sums(16);
+        for (int i = 1; i <= 1000; i++) {
+            sums.Append(i);
+        }
+        assert(sums.Reduce() == 500500 && sums.GetDirtySegmentCount() == 0);
+        sums.PopFront(10);
+        sums.Set(500, 0);
+        assert(sums.GetDirtySegmentCount() == 2);
+        assert(sums.RangeReduce(0, sums.GetSize()) == 500500 - 55 - 511);
+
+        SummarizedSegmentDeque<long long, SumMonoid<long long>> copy(sums);
+        assert(copy.Reduce() == sums.Reduce() && copy.RangeReduce(5, 6) == 16);
+
+        // Moved-from deques stay usable, both heap-backed and inline.
+        SummarizedSegmentDeque<long long, SumMonoid<long long>> moved(std::move(copy));
+        assert(moved.Reduce() == sums.Reduce() && copy.IsEmpty() && copy.Reduce() == 0);
+        copy.Append(5);
+        copy.Prepend(7);
+        assert(copy.Reduce() == 12 && copy.RangeReduce(0, 1) == 7);
+
+        SummarizedSegmentDeque<long long, SumMonoid<long long>> small(16);
+        small.Append(3);
+        moved = std::move(small);
+        assert(moved.GetSize() == 1 && moved.Reduce() == 3 && small.IsEmpty());
+        small.Append(4);
+        assert(small.Reduce() == 4);
+        small = std::move(sums);
+        assert(small.Reduce() == 500500 - 55 - 511);
+        sums.Append(1);
+        assert(sums.Reduce() == 1 && sums.GetDirtySegmentCount() == 0);
+
+        std::cout << "Segment summary tests passed\n";
+    }
+    static void TestWindowedAggregates() {
+        std::cout << "Testing WindowedSegmentDeque\n";
+
+        WindowedSegmentDeque<int, MaxMonoid<int>> maxima(4);
+        WindowedSegmentDeque<int, ConcatMonoid> ordered(4);
+        std::vector<int> window;
+        unsigned int state = 99;
+
+        assert(maxima.Aggregate() == std::numeric_limits<int>::lowest() && ordered.Aggregate().empty());
+
+        for (int step = 0; step < 5000; step++) {
+            state = state * 1103515245u + 12345u;
+            int value = static_cast<int>(state >> 16) % 1000;
+
+            if ((state >> 4) % 3 != 0 || window.empty()) {
+                maxima.Append(value);
+                ordered.Append(value);
+                window.push_back(value);
+            } else {
+                size_t count = (state >> 8) % (window.size() < 3 ? window.size() + 1 : 3);
+                maxima.PopFront(count);
+                ordered.PopFront(count);
+                window.erase(window.begin(), window.begin() + count);
+            }
+
+            int max = std::numeric_limits<int>::lowest();
+            std::string concatenated;
+            for (int item : window) {
+                max = item > max ? item : max;
+                concatenated += std::to_string(item) + ",";
+            }
+
+            assert(maxima.Aggregate() == max && ordered.Aggregate() == concatenated);
+            assert(maxima.GetSize() == window.size());
+        }
+
+        assert(maxima.GetFirst() == window.front() && maxima.GetLast() == window.back());
+
+        WindowedSegmentDeque<long long, SumMonoid<long long>> sums;
+        for (int i = 1; i <= 100; i++) {
+            sums.Append(i);
+            if (sums.GetSize() > 10) {
+                sums.PopFront();
+            }
+        }
+        assert(sums.Aggregate() == 955);
+
+        sums.Clear();
+        assert(sums.IsEmpty() && sums.Aggregate() == 0);
+
+        try {
+            sums.PopFront();
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        std::cout << "WindowedSegmentDeque tests passed\n";
+    }
+    static void TestLoadSave() {
+        std::cout << "Testing DequeIO load/save\n";
+
+        const std::string path = "deque_io_test.txt";
+
+        SegmentDeque<int> deque(8);
+        for (int i = -500; i < 1500; i++) {
+            deque.Append(i * 37);
+        }
+        assert(DequeIO::SaveIntegers(path, deque) == 2000);
+
+        for (size_t threads = 1; threads <= 5; threads += 2) {
+            SegmentDeque<int> loaded(8);
+            loaded.Append(42);
+            assert(DequeIO::LoadIntegers(path, loaded, threads) == 2000);
+            assert(loaded.GetSize() == 2000 && loaded.Get(0) == -500 * 37 && loaded.Get(1999) == 1499 * 37);
+            for (size_t i = 0; i < loaded.GetSize(); i++) {
+                assert(loaded[i] == deque[i]);
+            }
+        }
+
+        // The loaded deque keeps the target's segment layout.
+        for (size_t threads = 1; threads <= 3; threads += 2) {
+            SegmentDeque<int> paged(SegmentLayout::Bytes(4096));
+            assert(DequeIO::LoadIntegers(path, paged, threads) == 2000 && paged.Get(1999) == 1499 * 37);
+            assert(paged.GetSegmentCapacity() == 1024 && paged.GetSegmentLayout().alignment == SegmentLayout::PAGE_BYTES);
+            assert(HeapSegmentsAligned(paged, SegmentLayout::PAGE_BYTES));
+        }
+
+        {
+            std::ofstream file(path);
+            file << "  1,2, -3\r\n\t4,,5\n";
+        }
+        SegmentDeque<long long> parsed;
+        assert(DequeIO::LoadIntegers(path, parsed, 3) == 5);
+        assert(parsed.Get(2) == -3 && parsed.Get(4) == 5);
+
+        // Chunks without numbers and numbers spanning several segments per chunk.
+        {
+            std::ofstream file(path);
+            file << std::string(64, ' ');
+            for (int i = 0; i < 300; i++) {
+                file << i << (i % 7 ? ' ' : '\n');
+            }
+            file << std::string(64, ',');
+        }
+        for ([[maybe_unused]] size_t threads : {2, 6, 40}) {
+            SegmentDeque<int, 0> values(7);
+            assert(DequeIO::LoadIntegers(path, values, threads) == 300);
+            for (int i = 0; i < 300; i++) {
+                assert(values[i] == i);
+            }
+        }
+
+        {
+            std::ofstream file(path);
+            for (int i = 0; i < 300; i++) {
+                file << (i == 250 ? "2x5" : std::to_string(i)) << ' ';
+            }
+        }
+        try {
+            DequeIO::LoadIntegers(path, parsed, 4);
+            assert(false);
+        } catch (const std::invalid_argument&) {}
+        assert(parsed.GetSize() == 5 && parsed.Get(4) == 5);
+
+        {
+            std::ofstream file(path);
+            file << "1 2 x3 4\n";
+        }
+        try {
+            DequeIO::LoadIntegers(path, parsed);
+            assert(false);
+        } catch (const std::invalid_argument&) {}
+        assert(parsed.GetSize() == 5);
+
+        {
+            std::ofstream file(path);
+            file << "99999999999\n";
+        }
+        try {
+            DequeIO::LoadIntegers(path, deque);
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        {
+            std::ofstream file(path);
+        }
+        assert(DequeIO::LoadIntegers(path, parsed) == 0 && parsed.IsEmpty());
+
+        std::remove(path.c_str());
+
+        try {
+            DequeIO::LoadIntegers(path, parsed);
+            assert(false);
+        } catch (const std::runtime_error&) {}
+
+        std::cout << "DequeIO tests passed\n";
+    }
+
+    static void TestWriteTo() {
+        std::cout << "Testing WriteTo\n";
+
+        SegmentDeque<int> deque(4);
+        std::ostringstream empty;
+        deque.WriteTo(empty);
+        assert(empty.str().empty());
+
+        std::string expected;
+        for (int i = -10; i < 30000; i++) {
+            deque.Append(i * 7);
+            expected += (expected.empty() ? "" : ", ") + std::to_string(i * 7);
+        }
+        deque.PopFront();
+        deque.Prepend(-70);
+
+        std::ostringstream all;
+        deque.WriteTo(all);
+        assert(all.str() == expected);
+
+        std::ostringstream range;
+        deque.WriteTo(range, " ", 3, 7);
+        assert(range.str() == "-49 -42 -35 -28");
+
+        std::ostringstream tail;
+        deque.WriteTo(tail, "\n", deque.GetSize() - 2, deque.GetSize());
+        assert(tail.str() == "209986\n209993");
+
+        std::ostringstream none;
+        deque.WriteTo(none, ", ", 5, 5);
+        assert(none.str().empty());
+
+        try {
+            deque.WriteTo(none, ", ", 6, 5);
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        try {
+            deque.WriteTo(none, ", ", 0, deque.GetSize() + 1);
+            assert(false);
+        } catch (const std::out_of_range&) {}
+
+        SegmentDeque<std::string> words(2);
+        words.Append("b");
+        words.Append("c");
+        words.Prepend("a");
+        std::ostringstream text;
+        words.WriteTo(text, "-");
+        assert(text.str() == "a-b-c");
+
+        // Character types print as characters, not as their codes.
+        SegmentDeque<char> letters(2);
+        letters.Append('x');
+        letters.Append('y');
+        letters.Append('z');
+        std::ostringstream chars;
+        letters.WriteTo(chars, "");
+        assert(chars.str() == "xyz");
+
+        // Floating-point output matches what the stream itself would print.
+        SegmentDeque<double> values(3);
+        std::ostringstream streamed;
+        for (int i = 0; i < 20; i++) {
+            double value = (i - 10) * 3.14159265358979 / 7 + (i % 3) * 1e7;
+            values.Append(value);
+            streamed << (i == 0 ? "" : ";") << value;
+        }
+
+        std::ostringstream general;
+        values.WriteTo(general, ";");
+        assert(general.str() == streamed.str());
+
+        std::ostringstream fixed_expected;
+        std::ostringstream fixed_written;
+        fixed_expected << std::fixed << std::setprecision(2) << values[0] << " " << values[1];
+        fixed_written << std::fixed << std::setprecision(2);
+        values.WriteTo(fixed_written, " ", 0, 2);
+        assert(fixed_written.str() == fixed_expected.str());
+
+        std::ostringstream shown_expected;
+        std::ostringstream shown_written;
+        shown_expected << std::showpos << values[10];
+        shown_written << std::showpos;
+        values.WriteTo(shown_written, "", 10, 11);
+        assert(shown_written.str() == shown_expected.str());
+
+        // BufferedWriter over a stream, with a buffer smaller than some of the writes.
+        std::ostringstream buffered;
+        {
+            BufferedWriter writer(buffered, 8);
+            writer.WriteInteger(-1234567890123LL);
+            writer.Write(std::string(40, 'x'));
+            writer.Write(',');
+            writer.WriteInteger(42u);
+            writer.Close();
+            writer.Close();
+        }
+        assert(buffered.str() == "-1234567890123" + std::string(40, 'x') + ",42");
+
+        std::cout << "WriteTo tests passed\n";
+    }
+
+    static void TestStreamingFlatMap() {
+        std::cout << "Testing streaming FlatMap\n";
+
+        SegmentDeque<int> empty;
+        assert(empty.FlatMap<int>([](int x, SegmentDeque<int>::Emitter& emit) { emit(x); }).IsEmpty());
+
+        SegmentDeque<int> deque(4);
+        for (int i = 0; i < 200; i++) {
+            deque.Append(i);
+        }
+
+        auto repeated = deque.FlatMap<long long>([](int x, SegmentDeque<long long>::Emitter& emit) {
+            for (int j = 0; j < x % 4; j++) {
+                emit(x * 10LL + j);
+            }
+        });
+        [[maybe_unused]] size_t position = 0;
+        for (int i = 0; i < 200; i++) {
+            for (int j = 0; j < i % 4; j++) {
+                assert(repeated[position++] == i * 10LL + j);
+            }
+        }
+        assert(repeated.GetSize() == position && position == 300);
+
+        auto hinted = deque.FlatMap<int>([](int x, SegmentDeque<int>::Emitter& emit) {
+            emit(x);
+            emit(-x);
+        }, [](int) { return 2; });
+        assert(hinted.GetSize() == 400 && hinted[0] == 0 && hinted[399] == -199);
+        assert(hinted.GetSegmentCount() == 100 && hinted.GetSpareSegmentCount() == 0);
+
+        SegmentDeque<std::string> lines(2);
+        lines.Append("to be or");
+        lines.Append("");
+        lines.Append("not to  be");
+        auto words = lines.FlatMap<std::string>([](const std::string& line, SegmentDeque<std::string>::Emitter& emit) {
+            size_t start = 0;
+            while (start < line.size()) {
+                size_t end = line.find(' ', start);
+                end = end == std::string::npos ? line.size() : end;
+                if (end > start) {
+                    emit(line.substr(start, end - start));
+                }
+                start = end + 1;
+            }
+        }, [](const std::string& line) { return std::count(line.begin(), line.end(), ' ') + 1; });
+        assert(words.GetSize() == 6 && words[0] == "to" && words[3] == "not" && words[5] == "be");
+
+        SegmentDeque<int> target(3);
+        target.Prepend(-1);
+        SegmentDeque<int>::Emitter emit(target);
+        for (int i = 0; i < 100; i++) {
+            emit.Emit(i);
+        }
+        assert(target.GetSize() == 101 && target[0] == -1 && target[100] == 99 && !target.IsInline());
+
+        std::cout << "Streaming FlatMap tests passed\n";
+    }
+
+    template <typename T, typename Predicate>
+    static void CheckWhere(size_t segment_capacity, size_t count, Predicate predicate) {
+        SegmentDeque<T> deque(segment_capacity);
+        std::vector<T> expected;
+        unsigned long long state = 12345;
+
+        for (size_t i = 0; i < count; i++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            T value = static_cast<T>(static_cast<long long>(state >> 33) % 201 - 100);
+
+            if (i % 3 == 0) {
+                deque.Prepend(value);
+            } else {
+                deque.Append(value);
+            }
+        }
+
+        for (const T& value : deque) {
+            if (predicate(value)) {
+                expected.push_back(value);
+            }
+        }
+
+        SegmentDeque<T> filtered = deque.Where(predicate);
+        assert(filtered.GetSize() == expected.size());
+        [[maybe_unused]] size_t position = 0;
+        for ([[maybe_unused]] const T& value : filtered) {
+            assert(value == expected[position++]);
+        }
+    }
+
+    static void TestWhereCompaction() {
+        std::cout << "Testing Where compaction\n";
+
+        const size_t capacities[] = {1, 5, 16, 1024};
+        const size_t counts[] = {0, 7, 8, 9, 100, 5000};
+
+        for (size_t capacity : capacities) {
+            for (size_t count : counts) {
+                CheckWhere<int>(capacity, count, [](int x) { return x % 2 == 0; });
+                CheckWhere<int>(capacity, count, [](int x) { return x > 0; });
+                CheckWhere<int>(capacity, count, [](int) { return true; });
+                CheckWhere<int>(capacity, count, [](int) { return false; });
+                CheckWhere<unsigned>(capacity, count, [](unsigned x) { return x % 3 == 1; });
+                CheckWhere<float>(capacity, count, [](float x) { return x < 0.5f; });
+                CheckWhere<double>(capacity, count, [](double x) { return x >= 10; });
+                CheckWhere<long long>(capacity, count, [](long long x) { return x % 5 != 0; });
+                CheckWhere<char>(capacity, count, [](char x) { return x > 20; });
+            }
+        }
+
+        SegmentDeque<std::string> words(2);
+        words.Append("a");
+        words.Append("bb");
+        words.Append("ccc");
+        auto longer = words.Where([](const std::string& word) { return word.size() > 1; });
+        assert(longer.GetSize() == 2 && longer[0] == "bb" && longer[1] == "ccc");
+
+        std::cout << "Where compaction tests passed\n";
+    }
+
+    static void TestInPlaceTransforms() {
+        std::cout << "Testing in-place Transform/RemoveIf/Retain\n";
+
+        SegmentDeque<int> deque(4);
+        for (int i = 0; i < 50; i++) {
+            deque.Append(i);
+        }
+        deque.Prepend(-1);
+        deque.Prepend(-2);
+
+        deque.Transform([](int x) { return x * 3; });
+        assert(deque.GetSize() == 52 && deque[0] == -6 && deque[51] == 147);
+
+        [[maybe_unused]] size_t segments_before = deque.GetSegmentCount();
+        assert(deque.RemoveIf([](int x) { return x % 2 != 0; }) == 26);
+        assert(deque.GetSize() == 26 && deque.GetSegmentCount() < segments_before);
+        int expected = -6;
+        for ([[maybe_unused]] int value : deque) {
+            assert(value == expected);
+            expected += 6;
+        }
+        assert(deque.GetSegmentCount() == deque.GetSegmentIndex(deque.GetSize() - 1) + 1);
+
+        deque.Append(1000);
+        deque.Prepend(-1000);
+        assert(deque.GetSize() == 28 && deque[0] == -1000 && deque[1] == -6 && deque[27] == 1000);
+
+        assert(deque.Retain([](int x) { return x > 500; }) == 27);
+        assert(deque.GetSize() == 1 && deque[0] == 1000 && deque.GetSegmentCount() == 1);
+        assert(deque.RemoveIf([](int) { return true; }) == 1 && deque.IsEmpty());
+        deque.Append(7);
+        assert(deque.GetSize() == 1 && deque[0] == 7);
+
+        SegmentDeque<int> small;
+        for (int i = 0; i < 10; i++) {
+            small.Append(i);
+        }
+        assert(small.IsInline() && small.Retain([](int x) { return x >= 5; }) == 5);
+        assert(small.GetSize() == 5 && small[0] == 5 && small[4] == 9);
+
+        SegmentDeque<int> failing(3);
+        for (int i = 0; i < 20; i++) {
+            failing.Append(i);
+        }
+        try {
+            failing.RemoveIf([](int x) {
+                if (x == 10) {
+                    throw std::runtime_error("predicate failed");
+                }
+                return x % 2 == 0;
+            });
+            assert(false);
+        } catch (const std::runtime_error&) {}
+        assert(failing.GetSize() == 15 && failing[0] == 1 && failing[4] == 9 && failing[5] == 10 && failing[14] == 19);
+
+        SegmentDeque<std::string> words(2);
+        const char* text[] = {"keep", "drop", "keep", "keep", "drop"};
+        for (const char* word : text) {
+            words.Append(word);
+        }
+        words.Transform([](const std::string& word) { return word + "!"; });
+        assert(words.RemoveIf([](const std::string& word) { return word == "drop!"; }) == 2);
+        assert(words.GetSize() == 3);
+        for ([[maybe_unused]] const std::string& word : words) {
+            assert(word == "keep!");
+        }
+
+        std::cout << "In-place Transform/RemoveIf/Retain tests passed\n";
+    }
+
+    static void TestMemoryUsage() {
+        std::cout << "Testing MemoryUsage\n";
+
+        SegmentDeque<int> small;
+        DequeMemoryUsage usage = small.MemoryUsage();
+        assert(usage.payload_bytes == 0 && usage.slack_bytes == 32 * sizeof(int));
+        assert(usage.GetTotalBytes() == sizeof(small) && usage.fill_histogram[0] == 1);
+
+        for (int i = 0; i < 32; i++) {
+            small.Append(i);
+        }
+        usage = small.MemoryUsage();
+        assert(usage.payload_bytes == 32 * sizeof(int) && usage.slack_bytes == 0);
+        assert(usage.fill_histogram[DequeMemoryUsage::FILL_BUCKETS - 1] == 1);
+
+        // Segments of 4, 4 and 2 elements: two full ones and one half full.
+        SegmentDeque<int, 0> deque(4);
+        for (int i = 0; i < 10; i++) {
+            deque.Append(i);
+        }
+        usage = deque.MemoryUsage();
+        assert(usage.payload_bytes == 10 * sizeof(int) && usage.slack_bytes == 2 * sizeof(int));
+        assert(usage.fill_histogram[0] == 0 && usage.fill_histogram[1] == 0);
+        assert(usage.fill_histogram[2] == 1 && usage.fill_histogram[3] == 2);
+        [[maybe_unused]] size_t metadata = usage.metadata_bytes;
+        assert(metadata >= sizeof(deque) + 3 * sizeof(Segment<int>));
+
+        // Popped slots at the front and spare segments count as slack.
+        deque.PopFront(3);
+        usage = deque.MemoryUsage();
+        assert(usage.payload_bytes == 7 * sizeof(int) && usage.slack_bytes == 5 * sizeof(int));
+        assert(usage.fill_histogram[1] == 1 && usage.fill_histogram[2] == 1 && usage.fill_histogram[3] == 1);
+
+        deque.ReserveBack(8);
+        usage = deque.MemoryUsage();
+        assert(deque.GetSpareSegmentCount() == 2);
+        assert(usage.slack_bytes == (5 + 2 * 4) * sizeof(int));
+        assert(usage.metadata_bytes == metadata + 2 * sizeof(Segment<int>));
+
+        size_t buckets = 0;
+        for (size_t i = 0; i < DequeMemoryUsage::FILL_BUCKETS; i++) {
+            buckets += usage.fill_histogram[i];
+        }
+        assert(buckets == deque.GetSegmentCount());
+
+        // With the default layout, bookkeeping stays a small fraction of the payload.
+        SegmentDeque<int> large;
+        for (int i = 0; i < 100000; i++) {
+            large.Append(i);
+        }
+        usage = large.MemoryUsage();
+        assert(usage.payload_bytes == 100000 * sizeof(int));
+        assert(usage.metadata_bytes * 8 < usage.payload_bytes);
+
+        std::cout << "MemoryUsage tests passed\n";
+    }
+
+    template <typename T, size_t InlineCapacity>
+    static bool HeapSegmentsAligned(const SegmentDeque<T, InlineCapacity>& deque, size_t alignment) {
+        for (size_t i = 0; i < deque.GetSegmentCount(); i++) {
+            const Segment<T>* segment = deque.GetSegment(i);
+            if (!deque.IsInline() && reinterpret_cast<uintptr_t>(segment->items) % alignment != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void TestSegmentLayout() {
+        std::cout << "Testing SegmentLayout\n";
+
+        struct Record {
+            char payload[1024];
+        };
+
+        assert(SegmentDeque<char>(SegmentLayout::Bytes(4096)).GetSegmentCapacity() == 4096);
+        assert(SegmentDeque<int>(SegmentLayout::Bytes(4096)).GetSegmentCapacity() == 1024);
+        assert(SegmentDeque<Record>(SegmentLayout::Bytes(4096)).GetSegmentCapacity() == 4);
+        assert(SegmentDeque<Record>(SegmentLayout::Bytes(100)).GetSegmentCapacity() == 1);
+        assert(SegmentDeque<int>(SegmentLayout::Elements(16)).GetSegmentLayout().alignment == 0);
+
+        SegmentDeque<char> bytes(SegmentLayout::Bytes(4096));
+        for (int i = 0; i < 10000; i++) {
+            bytes.Append(static_cast<char>(i % 128));
+            bytes.Prepend(static_cast<char>(i % 64));
+        }
+        assert(bytes.GetSize() == 20000 && HeapSegmentsAligned(bytes, SegmentLayout::PAGE_BYTES));
+        assert(bytes[0] == static_cast<char>(9999 % 64) && bytes[19999] == static_cast<char>(9999 % 128));
+
+        SegmentDeque<int> small(SegmentLayout::Bytes(256));
+        for (int i = 0; i < 1000; i++) {
+            small.Append(i);
+        }
+        assert(small.GetSegmentCapacity() == 64 && HeapSegmentsAligned(small, SegmentLayout::CACHE_LINE_BYTES));
+
+        // Copies, Where results and assignments keep the layout.
+        SegmentDeque<int> copy(small);
+        SegmentDeque<int> evens = small.Where([](int x) { return x % 2 == 0; });
+        SegmentDeque<int> assigned;
+        assigned = copy;
+        assert(copy.GetSegmentLayout().alignment == SegmentLayout::CACHE_LINE_BYTES && HeapSegmentsAligned(copy, 64));
+        assert(evens.GetSize() == 500 && HeapSegmentsAligned(evens, 64));
+        assert(assigned.GetSegmentCapacity() == 64 && assigned[999] == 999 && HeapSegmentsAligned(assigned, 64));
+
+        SegmentDeque<std::string> strings(SegmentLayout::Bytes(512));
+        for (int i = 0; i < 200; i++) {
+            strings.Append("string number " + std::to_string(i));
+        }
+        strings.PopFront(50);
+        SegmentDeque<std::string> moved(std::move(strings));
+        assert(moved.GetSize() == 150 && moved[0] == "string number 50" && HeapSegmentsAligned(moved, 64));
+
+        // Map and FlatMap results keep the byte target, so their element count follows the
+        // new element size; element-count layouts keep the count.
+        SegmentDeque<char> chars = small.Map([](int x) { return static_cast<char>(x); });
+        SegmentDeque<double> doubles = small.Map([](int x) { return x * 0.5; });
+        assert(chars.GetSegmentCapacity() == 256 && doubles.GetSegmentCapacity() == 32);
+        assert(doubles.Get(999) == 499.5 && HeapSegmentsAligned(doubles, SegmentLayout::CACHE_LINE_BYTES));
+
+        SegmentDeque<int> paged_ints(SegmentLayout::Bytes(4096));
+        for (int i = 0; i < 3000; i++) {
+            paged_ints.Append(i);
+        }
+        auto twice = [](int x, SegmentDeque<long long>::Emitter& emit) {
+            emit(x);
+            emit(-x);
+        };
+        SegmentDeque<long long> flat = paged_ints.FlatMap<long long>(twice);
+        SegmentDeque<long long> hinted = paged_ints.FlatMap<long long>(twice, [](int) { return 2; });
+        assert(flat.GetSize() == 6000 && flat.GetSegmentCapacity() == 512 && flat.Get(5999) == -2999);
+        assert(HeapSegmentsAligned(flat, SegmentLayout::PAGE_BYTES) && HeapSegmentsAligned(hinted, SegmentLayout::PAGE_BYTES));
+        assert(hinted.GetSegmentLayout().bytes == 4096 && hinted.GetSegmentCapacity() == 512);
+
+        SegmentDeque<int> counted(SegmentLayout::Elements(16));
+        counted.Append(1);
+        SegmentDeque<std::string> names = counted.Map([](int x) { return std::to_string(x); });
+        assert(names.GetSegmentCapacity() == 16 && names.GetSegmentLayout().alignment == 0);
+
+        SegmentDeque<int, 0> huge(SegmentLayout::Bytes(SegmentLayout::HUGE_PAGE_BYTES, true));
+        for (int i = 0; i < 600000; i++) {
+            huge.Append(i);
+        }
+        assert(huge.GetSegmentCapacity() == SegmentLayout::HUGE_PAGE_BYTES / sizeof(int));
+        assert(huge.GetSegmentCount() == 2 && huge[599999] == 599999);
+        assert(HeapSegmentsAligned(huge, SegmentLayout::HUGE_PAGE_BYTES));
+
+        [[maybe_unused]] bool thrown = false;
+        try {
+            SegmentDeque<int> invalid(SegmentLayout{16, 0, 48, false});
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        std::cout << "SegmentLayout tests passed\n";
+    }
+
+    // Fills deque with count values starting at first, pops some at both ends to feed the
+    // spare pool, and checks every element through the arithmetic lookup of operator[].
+    template <size_t InlineCapacity>
+    static void ChurnAndCheck(SegmentDeque<int, InlineCapacity>& deque, int first, int count) {
+        deque.Clear();
+        for (int i = 0; i < count; i++) {
+            deque.Append(first + i);
+        }
+        deque.PopFront(count / 4);
+        deque.PopBack(count / 4);
+        for (int i = 0; i < count / 4; i++) {
+            deque.Prepend(first + count / 4 - 1 - i);
+        }
+        assert(static_cast<int>(deque.GetSize()) == count - count / 4);
+        for (int i = 0; i < count - count / 4; i++) {
+            assert(deque[i] == first + i && deque.Get(i) == first + i);
+        }
+        for (size_t i = 0; i < deque.GetSegmentCount(); i++) {
+            [[maybe_unused]] const Segment<int>* segment = deque.GetSegment(i);
+            assert(deque.IsInline() || segment->capacity == deque.GetSegmentCapacity());
+        }
+    }
+
+    static void TestLayoutChanges() {
+        std::cout << "Testing layout changes with spare segments\n";
+
+        SegmentDeque<int> narrow(4);
+        SegmentDeque<int> wide(16);
+        SegmentDeque<int> paged(SegmentLayout::Bytes(4096));
+        narrow.SetSpareLimit(8);
+        wide.SetSpareLimit(3);
+
+        ChurnAndCheck(narrow, 0, 200);
+        ChurnAndCheck(wide, 1000, 300);
+        ChurnAndCheck(paged, 5000, 5000);
+        assert(narrow.GetSpareSegmentCount() <= 8 && wide.GetSpareSegmentCount() <= 3);
+        assert(paged.GetSpareSegmentCount() == 0);
+
+        // Copy assignment to a different layout drops the old spares; the pool then refills
+        // with segments of the new layout, still within the deque's own limit.
+        narrow = wide;
+        assert(narrow.GetSegmentCapacity() == 16 && narrow.GetSpareSegmentCount() == 0);
+        ChurnAndCheck(narrow, 7, 500);
+        assert(narrow.GetSpareSegmentCount() <= 8);
+
+        narrow = paged;
+        assert(narrow.GetSegmentLayout().alignment == SegmentLayout::PAGE_BYTES);
+        ChurnAndCheck(narrow, 11, 3000);
+        assert(Tests::HeapSegmentsAligned(narrow, SegmentLayout::PAGE_BYTES));
+
+        // Reserved spares follow the layout too.
+        wide.ReserveBack(100);
+        wide = SegmentDeque<int>(4);
+        wide.ReserveBack(100);
+        ChurnAndCheck(wide, 3, 150);
+
+        // Same layout: the spares are reused across assignment.
+        SegmentDeque<int, 0> heap(8);
+        SegmentDeque<int, 0> other(8);
+        heap.SetSpareLimit(100);
+        ChurnAndCheck(heap, 0, 400);
+        ChurnAndCheck(other, 42, 100);
+        heap = other;
+        assert(heap.GetSpareSegmentCount() > 0 && heap.GetSize() == other.GetSize());
+        ChurnAndCheck(heap, 9, 800);
+
+        // Lowering the limit stops the pool from growing; segments already in it stay.
+        [[maybe_unused]] size_t spares = heap.GetSpareSegmentCount();
+        heap.SetSpareLimit(0);
+        heap.Clear();
+        assert(heap.GetSpareSegmentCount() <= spares && heap.IsEmpty());
+
+        std::cout << "Layout change tests passed\n";
+    }
+
+    static void TestConcurrentDeque() {
+        std::cout << "Testing ConcurrentSegmentDeque\n";
+
+        ConcurrentSegmentDeque<std::string> words(2);
+        std::string word;
+        assert(words.IsEmpty() && !words.TryPopFront(word));
+        words.Append("a");
+        words.Append(std::string("b"));
+        const std::string batch[] = {"c", "d", "e"};
+        words.Append(batch, 3);
+        assert(words.GetSize() == 5);
+        assert(words.TryPopFront(word) && word == "a");
+        std::string popped[8];
+        assert(words.PopFront(popped, 8) == 4 && popped[0] == "b" && popped[3] == "e");
+        assert(words.IsEmpty() && words.PopFront(popped, 8) == 0);
+
+        try {
+            ConcurrentSegmentDeque<int> invalid(0);
+            assert(false);
+        } catch (const std::invalid_argument&) {}
+
+        const int PRODUCERS = 4;
+        const int CONSUMERS = 3;
+        const int PER_PRODUCER = 20000;
+
+        ConcurrentSegmentDeque<long long> deque(64);
+        std::atomic<int> consumed(0);
+        std::vector<std::vector<long long>> received(CONSUMERS);
+        std::vector<std::thread> threads;
+
+        for (int p = 0; p < PRODUCERS; p++) {
+            threads.emplace_back([&deque, p]() {
+                long long values[37];
+                int i = 0;
+                while (i < PER_PRODUCER) {
+                    if (p % 2 == 0 || i + 37 > PER_PRODUCER) {
+                        deque.Append(p * 1000000LL + i++);
+                    } else {
+                        for (int j = 0; j < 37; j++) {
+                            values[j] = p * 1000000LL + i++;
+                        }
+                        deque.Append(values, 37);
+                    }
+                }
+            });
+        }
+
+        for (int c = 0; c < CONSUMERS; c++) {
+            threads.emplace_back([&, c]() {
+                long long values[16];
+                while (consumed.load() < PRODUCERS * PER_PRODUCER) {
+                    size_t count = 0;
+                    if (c == 0) {
+                        count = deque.TryPopFront(values[0]) ? 1 : 0;
+                    } else {
+                        count = deque.PopFront(values, 16);
+                    }
+                    if (count == 0) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    received[c].insert(received[c].end(), values, values + count);
+                    consumed.fetch_add(static_cast<int>(count));
+                }
+            });
+        }
+
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        std::vector<long long> all;
+        for (const std::vector<long long>& values : received) {
+            std::vector<long long> last(PRODUCERS, -1);
+            for (long long value : values) {
+                int producer = static_cast<int>(value / 1000000);
+                assert(value > last[producer]);
+                last[producer] = value;
+            }
+            all.insert(all.end(), values.begin(), values.end());
+        }
+        std::sort(all.begin(), all.end());
+        assert(all.size() == static_cast<size_t>(PRODUCERS * PER_PRODUCER));
+        for (int p = 0; p < PRODUCERS; p++) {
+            for (int i = 0; i < PER_PRODUCER; i++) {
+                assert(all[p * PER_PRODUCER + i] == p * 1000000LL + i);
+            }
+        }
+        assert(deque.IsEmpty());
+
+        std::cout << "ConcurrentSegmentDeque tests passed\n";
+    }
+
+    // Counts default constructions, i.e. slots of newly allocated segments.
+    struct SegmentSlot {
+        static int constructed;
+        int value;
+
+        SegmentSlot() : value(0) { constructed++; }
+        SegmentSlot(int value) : value(value) {}
+    };
+
+    static void TestBoundedQueue() {
+        std::cout << "Testing BoundedSegmentQueue\n";
+
+        BoundedSegmentQueue<int> queue(5, 2);
+        int value = 0;
+        [[maybe_unused]] bool done = queue.TryPop(value);
+        assert(queue.GetCapacity() == 5 && !done);
+        for (int i = 0; i < 5; i++) {
+            done = queue.TryPush(i);
+            assert(done);
+        }
+        done = queue.TryPush(5);
+        assert(!done && queue.GetSize() == 5);
+        done = queue.PushFor(5, std::chrono::milliseconds(20));
+        assert(!done);
+        done = queue.TryPop(value);
+        assert(done && value == 0);
+
+        const int values[] = {10, 11, 12};
+        [[maybe_unused]] size_t moved = queue.TryPush(values, 3);
+        assert(moved == 1);
+        int output[8];
+        moved = queue.TryPop(output, 8);
+        assert(moved == 5 && output[0] == 1 && output[4] == 10);
+        done = queue.PopFor(value, std::chrono::milliseconds(20));
+        assert(!done);
+
+        std::thread blocked([&]() {
+            [[maybe_unused]] size_t first = queue.Push(values, 3);
+            [[maybe_unused]] size_t second = queue.Push(values, 3);
+            [[maybe_unused]] bool third = queue.Push(1);
+            assert(first == 3 && second == 2 && !third);
+        });
+        while (queue.GetSize() < 5) {
+            std::this_thread::yield();
+        }
+        queue.Close();
+        blocked.join();
+        done = queue.TryPush(1);
+        assert(queue.IsClosed() && !done);
+        moved = queue.Pop(output, 8);
+        assert(moved == 5 && output[3] == 10 && output[4] == 11);
+        done = queue.Pop(value);
+        moved = queue.Pop(output, 8);
+        assert(!done && moved == 0);
+
+        try {
+            BoundedSegmentQueue<int> invalid(0);
+            assert(false);
+        } catch (const std::invalid_argument&) {}
+
+        const int PRODUCERS = 3;
+        const int CONSUMERS = 3;
+        const int PER_PRODUCER = 20000;
+
+        BoundedSegmentQueue<long long> work(16, 4);
+        std::vector<std::vector<long long>> received(CONSUMERS);
+        std::vector<std::thread> threads;
+
+        for (int p = 0; p < PRODUCERS; p++) {
+            threads.emplace_back([&work, p]() {
+                long long batch[5];
+                int i = 0;
+                while (i < PER_PRODUCER) {
+                    if (p == 0 || i + 5 > PER_PRODUCER) {
+                        [[maybe_unused]] bool pushed = work.Push(p * 1000000LL + i++);
+                        assert(pushed);
+                    } else {
+                        for (int j = 0; j < 5; j++) {
+                            batch[j] = p * 1000000LL + i++;
+                        }
+                        [[maybe_unused]] size_t pushed = work.Push(batch, 5);
+                        assert(pushed == 5);
+                    }
+                }
+            });
+        }
+
+        for (int c = 0; c < CONSUMERS; c++) {
+            threads.emplace_back([&work, &received, c]() {
+                long long batch[7];
+                while (true) {
+                    size_t count = c == 0 ? (work.Pop(batch[0]) ? 1 : 0) : work.Pop(batch, 7);
+                    if (count == 0) {
+                        break;
+                    }
+                    assert(work.GetSize() <= 16);
+                    received[c].insert(received[c].end(), batch, batch + count);
+                }
+            });
+        }
+
+        for (int p = 0; p < PRODUCERS; p++) {
+            threads[p].join();
+        }
+        work.Close();
+        for (int c = 0; c < CONSUMERS; c++) {
+            threads[PRODUCERS + c].join();
+        }
+
+        std::vector<long long> all;
+        for (const std::vector<long long>& values : received) {
+            std::vector<long long> last(PRODUCERS, -1);
+            for (long long item : values) {
+                int producer = static_cast<int>(item / 1000000);
+                assert(item > last[producer]);
+                last[producer] = item;
+            }
+            all.insert(all.end(), values.begin(), values.end());
+        }
+        std::sort(all.begin(), all.end());
+        assert(all.size() == static_cast<size_t>(PRODUCERS * PER_PRODUCER));
+        for (size_t i = 1; i < all.size(); i++) {
+            assert(all[i] != all[i - 1]);
+        }
+
+        BoundedSegmentQueue<SegmentSlot> recycled(100, 8);
+        SegmentSlot slot;
+        [[maybe_unused]] int constructed = SegmentSlot::constructed;
+        for (int round = 0; round < 1000; round++) {
+            for (int i = 0; i < 37; i++) {
+                done = recycled.TryPush(SegmentSlot(round + i));
+                assert(done);
+            }
+            for (int i = 0; i < 37; i++) {
+                done = recycled.TryPop(slot);
+                assert(done && slot.value == round + i);
+            }
+        }
+        assert(SegmentSlot::constructed == constructed);
+
+        std::cout << "BoundedSegmentQueue tests passed\n";
+    }
+
+    static SegmentDeque<int> MakeDeque(size_t size) {
+        SegmentDeque<int> deque;
+        for (size_t i = 0; i < size; i++) {
+            deque.Append(static_cast<int>(i));
+        }
+        return deque;
+    }
+
+    // Best of several runs of run(size), in milliseconds.
+    template <typename Run>
+    static double MeasureBestMs(Run& run, size_t size) {
+        const int RUNS = 3;
+        double best = 0;
+
+        for (int i = 0; i < RUNS; i++) {
+            auto start = std::chrono::steady_clock::now();
+            volatile size_t result = run(size);
+            (void)result;
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            best = i == 0 || ms < best ? ms : best;
+        }
+
+        return best;
+    }
+
+    // Fits time ~ size^exponent between the smallest and largest of SCALING_STEPS doubling
+    // sizes. A linear operation that turned quadratic moves the exponent from ~1 to ~2, so the
+    // tolerance can be generous; a result over the limit is measured once more before failing.
+    template <typename Run>
+    static void CheckScaling(const std::string& name, double expected_exponent, Run run, size_t smallest = 1 << 16) {
+        const int SCALING_STEPS = 5;
+        const double EXPONENT_TOLERANCE = 0.45;
+
+        size_t largest = smallest << (SCALING_STEPS - 1);
+        double limit = expected_exponent + EXPONENT_TOLERANCE;
+        double exponent = 0;
+
+        for (int attempt = 0; attempt < 2; attempt++) {
+            double first = 0;
+            double last = 0;
+
+            for (size_t size = smallest; size <= largest; size *= 2) {
+                double ms = MeasureBestMs(run, size);
+                first = size == smallest ? ms : first;
+                last = ms;
+            }
+
+            // Guard against a timer that reports zero for the smallest size.
+            first = first > 1e-3 ? first : 1e-3;
+            exponent = std::log(last / first) / std::log(static_cast<double>(largest / smallest));
+
+            if (exponent <= limit) {
+                break;
+            }
+        }
+
+        std::ios_base::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << "  " << std::left << std::setw(40) << name << std::right << " n^" << std::fixed
+                  << std::setprecision(2) << exponent << " (limit n^" << limit << ")\n";
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+
+        if (exponent > limit) {
+            throw std::runtime_error(name + " grows as n^" + std::to_string(exponent) +
+                                     ", expected at most n^" + std::to_string(limit));
+        }
+    }
+
+#ifdef __cpp_impl_coroutine
+    static Generator<int> Countdown(int from) {
+        for (int i = from; i > 0; i--) {
+            if (i == 13) {
+                throw std::runtime_error("unlucky");
+            }
+            co_yield i;
+        }
+    }
+
+    static Task Produce(AsyncSegmentDeque<int>& queue, AsyncSegmentDeque<int>& ticks, int count) {
+        for (int i = 0; i < count; i++) {
+            queue.Append(i);
+            co_await ticks.PopFront();
+        }
+        queue.Close();
+    }
+
+    static Task Consume(AsyncSegmentDeque<int>& queue, std::vector<int>& received) {
+        while (std::optional<int> value = co_await queue.PopFront()) {
+            received.push_back(*value);
+        }
+    }
+
+    static Task Fail(AsyncSegmentDeque<int>& queue) {
+        co_await queue.PopFront();
+        throw std::runtime_error("consumer failed");
+    }
+
+    static void TestCoroutines() {
+        std::cout << "Testing coroutine generator and AsyncSegmentDeque\n";
+
+        SegmentDeque<int> deque(3);
+        for (int i = 0; i < 10; i++) {
+            deque.Append(i);
+        }
+        deque.Prepend(-1);
+
+        [[maybe_unused]] int expected = -1;
+        for ([[maybe_unused]] int value : Generate(deque)) {
+            assert(value == expected++);
+        }
+        assert(expected == 10);
+
+        SegmentDeque<int> empty;
+        for (int value : Generate(empty)) {
+            (void)value;
+            assert(false);
+        }
+
+        int sum = 0;
+        for (int value : Countdown(5)) {
+            sum += value;
+        }
+        assert(sum == 15);
+
+        try {
+            for ([[maybe_unused]] int value : Countdown(20)) {
+                assert(value > 13);
+            }
+            assert(false);
+        } catch (const std::runtime_error&) {}
+
+        SingleThreadExecutor executor;
+        AsyncSegmentDeque<int> queue(executor, 4);
+        AsyncSegmentDeque<int> ticks(executor);
+        std::vector<int> first;
+        std::vector<int> second;
+
+        executor.Spawn(Consume(queue, first));
+        executor.Spawn(Consume(queue, second));
+        executor.Run();
+        assert(queue.GetWaitingCount() == 2 && executor.GetPendingTaskCount() == 2);
+
+        executor.Spawn(Produce(queue, ticks, 6));
+        executor.Run();
+        assert(first.size() == 1 && second.empty() && queue.GetWaitingCount() == 2);
+
+        for (int i = 0; i < 6; i++) {
+            ticks.Append(i);
+            executor.Run();
+        }
+        assert(queue.IsClosed() && executor.GetPendingTaskCount() == 0);
+        assert(first.size() + second.size() == 6);
+        assert(first[0] == 0 && second[0] == 1 && first[1] == 2);
+
+        AsyncSegmentDeque<int> buffered(executor);
+        std::vector<int> drained;
+        for (int i = 0; i < 40; i++) {
+            buffered.Append(i);
+        }
+        buffered.Close();
+        executor.Spawn(Consume(buffered, drained));
+        executor.Run();
+        assert(drained.size() == 40 && drained[39] == 39 && buffered.GetSize() == 0);
+
+        try {
+            buffered.Append(1);
+            assert(false);
+        } catch (const std::runtime_error&) {}
+
+        AsyncSegmentDeque<int> failing(executor);
+        executor.Spawn(Fail(failing));
+        executor.Run();
+        failing.Append(1);
+        try {
+            executor.Run();
+            assert(false);
+        } catch (const std::runtime_error&) {}
+        assert(executor.GetPendingTaskCount() == 0);
+
+        std::cout << "Coroutine tests passed\n";
+    }
+#endif
+};
+
+int Tests::SegmentSlot::constructed = 0;
+
+void RunDequeTests() {
+    Tests::RunAllTests();
+}
+
+void RunDequeScalabilityTests() {
+    Tests::RunScalabilityTests();
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#ifndef WINDOWEDSEGMENTDEQUE_HPP
+#define WINDOWEDSEGMENTDEQUE_HPP
+
+#include <stdexcept>
+#include "SegmentDeque.hpp"
+#include "lib/Monoid.hpp"
+
+// FIFO window (Append at the back, PopFront at the front) with an O(1) Monoid aggregate of
+// its contents, kept with the two-stacks scheme: elements appended since the last flip are
+// folded into one running back aggregate, and the older elements carry suffix aggregates
+// that PopFront discards one by one. When those run out, the whole window is flipped into
+// new suffix aggregates, so every element is lifted and combined O(1) times amortized.
+template <typename T, typename Monoid>
+class WindowedSegmentDeque {
+public:
+    using Value = typename Monoid::Value;
+
+    explicit WindowedSegmentDeque(size_t segment_capacity = 16);
+
+    void Append(const T& value);
+    void PopFront();
+    void PopFront(size_t count);
+    void Clear();
+
+    const T& Get(size_t index) const;
+    const T& GetFirst() const;
+    const T& GetLast() const;
+    size_t GetSize() const;
+    bool IsEmpty() const;
+    const SegmentDeque<T>& GetDeque() const;
+
+    Value Aggregate() const;
+private:
+    SegmentDeque<T> items;
+    SegmentDeque<Value> front_aggregates;
+    Value back_aggregate;
+
+    void Flip();
+};
+
+template <typename T, typename Monoid>
+WindowedSegmentDeque<T, Monoid>::WindowedSegmentDeque(size_t segment_capacity)
+    : items(segment_capacity), front_aggregates(segment_capacity), back_aggregate(Monoid::Identity()) {}
+
+template <typename T, typename Monoid>
+void WindowedSegmentDeque<T, Monoid>::Append(const T& value) {
+    items.Append(value);
+    back_aggregate = Monoid::Combine(back_aggregate, Monoid::Lift(value));
+}
+
+template <typename T, typename Monoid>
+void WindowedSegmentDeque<T, Monoid>::Flip() {
+    Value suffix = Monoid::Identity();
+
+    for (size_t i = items.GetSize(); i > 0; i--) {
+        suffix = Monoid::Combine(Monoid::Lift(items[i - 1]), suffix);
+        front_aggregates.Prepend(suffix);
+    }
+
+    back_aggregate = Monoid::Identity();
+}
+
+template <typename T, typename Monoid>
+void WindowedSegmentDeque<T, Monoid>::PopFront() {
+    if (items.IsEmpty()) {
+        throw std::out_of_range("PopFront from empty deque");
+    }
+
+    if (front_aggregates.IsEmpty()) {
+        Flip();
+    }
+
+    items.PopFront();
+    front_aggregates.PopFront();
+}
+
+template <typename T, typename Monoid>
+void WindowedSegmentDeque<T, Monoid>::PopFront(size_t count) {
+    if (count > items.GetSize()) {
+        throw std::out_of_range("PopFront of " + std::to_string(count) + " elements from deque of size " + std::to_string(items.GetSize()));
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        PopFront();
+    }
+}
+
+template <typename T, typename Monoid>
+void WindowedSegmentDeque<T, Monoid>::Clear() {
+    items.Clear();
+    front_aggregates.Clear();
+    back_aggregate = Monoid::Identity();
+}
+
+template <typename T, typename Monoid>
+const T& WindowedSegmentDeque<T, Monoid>::Get(size_t index) const {
+    return items.Get(index);
+}
+
+template <typename T, typename Monoid>
+const T& WindowedSegmentDeque<T, Monoid>::GetFirst() const {
+    return items.Get(0);
+}
+
+template <typename T, typename Monoid>
+const T& WindowedSegmentDeque<T, Monoid>::GetLast() const {
+    if (items.IsEmpty()) {
+        throw std::out_of_range("Sequence is empty");
+    }
+
+    return items.Get(items.GetSize() - 1);
+}
+
+template <typename T, typename Monoid>
+size_t WindowedSegmentDeque<T, Monoid>::GetSize() const {
+    return items.GetSize();
+}
+
+template <typename T, typename Monoid>
+bool WindowedSegmentDeque<T, Monoid>::IsEmpty() const {
+    return items.IsEmpty();
+}
+
+template <typename T, typename Monoid>
+const SegmentDeque<T>& WindowedSegmentDeque<T, Monoid>::GetDeque() const {
+    return items;
+}
+
+template <typename T, typename Monoid>
+typename Monoid::Value WindowedSegmentDeque<T, Monoid>::Aggregate() const {
+    if (front_aggregates.IsEmpty()) {
+        return back_aggregate;
+    }
+
+    return Monoid::Combine(front_aggregates[0], back_aggregate);
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <cstddef>
 #include "Sequence.hpp"
 #include "DynamicArray.hpp"
+#include "PersistentVector.hpp"
 
 template <typename T>
 class ArraySequence : public Sequence<T> {
@@ -18,13 +19,16 @@ public:
 
     virtual ~ArraySequence();
 
-    T& GetFirst() override;
+    T& GetFirst();
     const T& GetFirst() const override;
-    T& GetLast() override;
+    T& GetLast();
     const T& GetLast() const override;
-    T& Get(size_t index) override;
+    T& Get(size_t index);
     const T& Get(size_t index) const override;
+    T& At(size_t index);
+    const T& At(size_t index) const;
 
+    // Non-virtual; bounds are checked only in debug builds (without NDEBUG).
     T& operator[](size_t index);
     const T& operator[](size_t index) const;
 
@@ -44,7 +48,7 @@ protected:
 };
 
 template <typename T>
-class MutableArraySequence : public ArraySequence<T> {
+class MutableArraySequence final : public ArraySequence<T> {
 public:
     MutableArraySequence() = default;
     using ArraySequence<T>::ArraySequence;
@@ -58,18 +62,32 @@ private:
     }
 };
 
+// Backed by a PersistentVector: copying is O(1) and shares storage with the original,
+// writes copy only the O(log n) path they touch, so earlier copies keep their contents.
 template <typename T>
-class ImmutableArraySequence : public ArraySequence<T> {
+class ImmutableArraySequence : public Sequence<T> {
 public:
-    using ArraySequence<T>::ArraySequence;
+    ImmutableArraySequence() = default;
+    ImmutableArraySequence(T* items, size_t size);
+    ImmutableArraySequence(size_t size);
+
+    const T& GetFirst() const override;
+    const T& GetLast() const override;
+    const T& Get(size_t index) const override;
+    const T& operator[](size_t index) const;
+
+    ImmutableArraySequence<T>* GetSubsequence(size_t start_index, size_t end_index) const override;
+    size_t GetSize() const override;
+    void Set(T value, size_t index);
+
+    void Append(const T& value) override;
+    void Prepend(const T& value) override;
+    void InsertAt(const T& value, size_t index) override;
+    ImmutableArraySequence<T>* Concat(const Sequence<T>* array_sequence) const override;
 private:
-    ArraySequence<T>* Instance() override{
-        return this->Clone();
-    }
+    PersistentVector<T> items;
 
-    ArraySequence<T>* Clone() const override {
-        return new ImmutableArraySequence<T>(*this);
-    }
+    explicit ImmutableArraySequence(const PersistentVector<T>& items) : items(items) {}
 };
 
 template <typename T>
@@ -146,6 +164,16 @@ const T& ArraySequence<T>::Get(size_t index) const {
     return items->Get(index);
 }
 
+template <typename T>
+T& ArraySequence<T>::At(size_t index) {
+    return items->At(index);
+}
+
+template <typename T>
+const T& ArraySequence<T>::At(size_t index) const {
+    return items->At(index);
+}
+
 template <typename T>
 T& ArraySequence<T>::operator[](size_t index) {
     return (*items)[index];
@@ -167,7 +195,7 @@ ArraySequence<T>* ArraySequence<T>::GetSubsequence(size_t start_index, size_t en
     T* temp_items = new T[length];
 
     for (size_t i = 0; i < length; i++) {
-        temp_items[i] = items->Get(i + start_index);
+        temp_items[i] = (*items)[i + start_index];
     }
 
     ArraySequence<T>* sub_sequence = this->Clone();
@@ -194,11 +222,18 @@ void ArraySequence<T>::Set(T value, size_t index) {
     }
 }
 
+// Capacity doubles when it runs out, so a run of Appends costs amortized O(1) each.
 template <typename T>
 void ArraySequence<T>::Append(const T& value) {
     ArraySequence<T>* instance = Instance();
-    instance->items->Resize(instance->items->GetSize() + 1);
-    instance->items->Set(value, instance->items->GetSize() - 1);
+    DynamicArray<T>& array = *instance->items;
+
+    if (array.GetSize() == array.GetCapacity()) {
+        array.Reserve(array.GetSize() > 0 ? 2 * array.GetSize() : 1);
+    }
+
+    array.Resize(array.GetSize() + 1);
+    array.Set(value, array.GetSize() - 1);
 
     if (instance != this) {
         *this = *instance;
@@ -209,13 +244,14 @@ void ArraySequence<T>::Append(const T& value) {
 template <typename T>
 void ArraySequence<T>::Prepend(const T& value) {
     ArraySequence<T>* instance = Instance();
-    instance->items->Resize(instance->items->GetSize() + 1);
+    DynamicArray<T>& array = *instance->items;
+    array.Resize(array.GetSize() + 1);
 
-    for (size_t i = instance->items->GetSize() - 1; i > 0; i--) {
-        instance->items->Set(instance->items->Get(i - 1), i);
+    for (size_t i = array.GetSize() - 1; i > 0; i--) {
+        array[i] = array[i - 1];
     }
 
-    instance->items->Set(value, 0);
+    array[0] = value;
 
     if (instance != this) {
         *this = *instance;
@@ -252,10 +288,87 @@ ArraySequence<T>* ArraySequence<T>::Concat(const Sequence<T>* array_sequence) co
     result->items->Resize(original_size + array_sequence->GetSize());
 
     for (size_t i = 0; i < array_sequence->GetSize(); i++) {
-        result->items->Set(array_sequence->Get(i), original_size + i);
+        (*result->items)[original_size + i] = array_sequence->Get(i);
     }
 
     return result;
 }
 
+template <typename T>
+ImmutableArraySequence<T>::ImmutableArraySequence(T* items, size_t size) : items(items, size) {}
+
+template <typename T>
+ImmutableArraySequence<T>::ImmutableArraySequence(size_t size) : items(size) {}
+
+template <typename T>
+const T& ImmutableArraySequence<T>::GetFirst() const {
+    return items.Get(0);
+}
+
+template <typename T>
+const T& ImmutableArraySequence<T>::GetLast() const {
+    return items.Get(items.GetSize() - 1);
+}
+
+template <typename T>
+const T& ImmutableArraySequence<T>::Get(size_t index) const {
+    return items.Get(index);
+}
+
+template <typename T>
+const T& ImmutableArraySequence<T>::operator[](size_t index) const {
+    return items.Get(index);
+}
+
+template <typename T>
+ImmutableArraySequence<T>* ImmutableArraySequence<T>::GetSubsequence(size_t start_index, size_t end_index) const {
+    return new ImmutableArraySequence<T>(items.GetSubVector(start_index, end_index));
+}
+
+template <typename T>
+size_t ImmutableArraySequence<T>::GetSize() const {
+    return items.GetSize();
+}
+
+template <typename T>
+void ImmutableArraySequence<T>::Set(T value, size_t index) {
+    items = items.Set(value, index);
+}
+
+template <typename T>
+void ImmutableArraySequence<T>::Append(const T& value) {
+    items = items.Append(value);
+}
+
+template <typename T>
+void ImmutableArraySequence<T>::Prepend(const T& value) {
+    items = items.Prepend(value);
+}
+
+template <typename T>
+void ImmutableArraySequence<T>::InsertAt(const T& value, size_t index) {
+    items = items.InsertAt(value, index);
+}
+
+template <typename T>
+ImmutableArraySequence<T>* ImmutableArraySequence<T>::Concat(const Sequence<T>* array_sequence) const {
+    if (!array_sequence || array_sequence->GetSize() == 0) {
+        throw std::invalid_argument("Argument is nullptr or empty");
+    }
+
+    auto* other = dynamic_cast<const ImmutableArraySequence<T>*>(array_sequence);
+
+    if (other) {
+        return new ImmutableArraySequence<T>(items.Concat(other->items));
+    }
+
+    PersistentVector<T> result = items;
+
+    for (size_t i = 0; i < array_sequence->GetSize(); i++) {
+        result = result.Append(array_sequence->Get(i));
+    }
+
+    return new ImmutableArraySequence<T>(result);
+}
+
 #endif
\ No newline at end of file
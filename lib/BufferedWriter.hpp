@@ -0,0 +1,182 @@
+#ifndef BUFFEREDWRITER_HPP
+#define BUFFEREDWRITER_HPP
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+// Integral types that a stream prints as numbers; bool and the character types print differently.
+template <typename T>
+struct IsPrintedAsInteger
+    : std::bool_constant<std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                         !std::is_same<T, char>::value && !std::is_same<T, signed char>::value &&
+                         !std::is_same<T, unsigned char>::value && !std::is_same<T, wchar_t>::value &&
+                         !std::is_same<T, char8_t>::value && !std::is_same<T, char16_t>::value &&
+                         !std::is_same<T, char32_t>::value> {};
+
+// Writes a file or a stream through one large buffer, so that formatting many small values
+// costs one fwrite (or stream write) per buffer instead of one stream operation per value.
+// A stream target keeps its own error state; file errors are thrown as std::runtime_error.
+class BufferedWriter {
+public:
+    explicit BufferedWriter(const std::string& path, size_t buffer_size = 1 << 20);
+    explicit BufferedWriter(std::ostream& stream, size_t buffer_size = 1 << 16);
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    void Write(const char* text, size_t length);
+    void Write(const std::string& text);
+    void Write(char symbol);
+
+    template <typename Integer>
+    void WriteInteger(Integer value);
+    // Same text as printf("%.*g") and friends for the given format and precision.
+    template <typename Floating>
+    void WriteFloat(Floating value, std::chars_format format, int precision);
+
+    // Flushes the buffer and closes the file; errors surface here rather than in the destructor.
+    // A stream is only flushed into, never closed.
+    void Close();
+    void Flush();
+private:
+    std::FILE* file;
+    std::ostream* stream;
+    char* buffer;
+    size_t capacity;
+    size_t used;
+    std::string path;
+
+    static const size_t MAX_INTEGER_LENGTH = 24;
+
+    void WriteOut(const char* text, size_t length);
+};
+
+inline BufferedWriter::BufferedWriter(const std::string& path, size_t buffer_size)
+    : file(nullptr), stream(nullptr), buffer(nullptr), capacity(buffer_size < MAX_INTEGER_LENGTH ? MAX_INTEGER_LENGTH : buffer_size),
+      used(0), path(path) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    }
+
+    buffer = new char[capacity];
+}
+
+inline BufferedWriter::BufferedWriter(std::ostream& stream, size_t buffer_size)
+    : file(nullptr), stream(&stream), buffer(nullptr),
+      capacity(buffer_size < MAX_INTEGER_LENGTH ? MAX_INTEGER_LENGTH : buffer_size), used(0) {
+    buffer = new char[capacity];
+}
+
+inline BufferedWriter::~BufferedWriter() {
+    if (file) {
+        std::fwrite(buffer, 1, used, file);
+        std::fclose(file);
+    } else if (stream) {
+        stream->write(buffer, used);
+    }
+
+    delete[] buffer;
+}
+
+inline void BufferedWriter::WriteOut(const char* text, size_t length) {
+    if (stream) {
+        stream->write(text, length);
+    } else if (std::fwrite(text, 1, length, file) != length) {
+        throw std::runtime_error("Cannot write file: " + path);
+    }
+}
+
+inline void BufferedWriter::Flush() {
+    if (used > 0) {
+        WriteOut(buffer, used);
+    }
+
+    used = 0;
+}
+
+inline void BufferedWriter::Close() {
+    if (stream) {
+        Flush();
+        stream = nullptr;
+        return;
+    }
+
+    if (!file) {
+        return;
+    }
+
+    Flush();
+
+    std::FILE* closing = file;
+    file = nullptr;
+
+    if (std::fclose(closing) != 0) {
+        throw std::runtime_error("Cannot close file: " + path);
+    }
+}
+
+inline void BufferedWriter::Write(const char* text, size_t length) {
+    if (used + length > capacity) {
+        Flush();
+
+        if (length > capacity) {
+            WriteOut(text, length);
+            return;
+        }
+    }
+
+    std::memcpy(buffer + used, text, length);
+    used += length;
+}
+
+inline void BufferedWriter::Write(const std::string& text) {
+    Write(text.data(), text.size());
+}
+
+inline void BufferedWriter::Write(char symbol) {
+    if (used == capacity) {
+        Flush();
+    }
+
+    buffer[used++] = symbol;
+}
+
+template <typename Integer>
+void BufferedWriter::WriteInteger(Integer value) {
+    static_assert(std::is_integral<Integer>::value, "WriteInteger needs an integral type");
+
+    if (used + MAX_INTEGER_LENGTH > capacity) {
+        Flush();
+    }
+
+    std::to_chars_result result = std::to_chars(buffer + used, buffer + capacity, value);
+    used = result.ptr - buffer;
+}
+
+template <typename Floating>
+void BufferedWriter::WriteFloat(Floating value, std::chars_format format, int precision) {
+    static_assert(std::is_floating_point<Floating>::value, "WriteFloat needs a floating-point type");
+
+    std::to_chars_result result = std::to_chars(buffer + used, buffer + capacity, value, format, precision);
+
+    if (result.ec != std::errc()) {
+        Flush();
+        result = std::to_chars(buffer, buffer + capacity, value, format, precision);
+
+        if (result.ec != std::errc()) {
+            throw std::length_error("Formatted value does not fit in the write buffer");
+        }
+    }
+
+    used = result.ptr - buffer;
+}
+
+#endif
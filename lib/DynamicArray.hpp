@@ -4,9 +4,10 @@
 #include <cstddef>
 #include <stdexcept>
 #include <string>
+#include "StaticSequence.hpp"
 
 template <typename T>
-class DynamicArray {
+class DynamicArray : public StaticSequence<DynamicArray<T>, T> {
 public:
     DynamicArray(T* items, size_t size);
     DynamicArray(size_t size);
@@ -19,17 +20,25 @@ public:
 
     T& Get(size_t index);
     const T& Get(size_t index) const;
+    T& At(size_t index);
+    const T& At(size_t index) const;
 
+    // Bounds are checked only in debug builds (without NDEBUG); use At() or Get() for checked access.
     T& operator[](size_t index);
     const T& operator[](size_t index) const;
 
     size_t GetSize() const;
+    size_t GetCapacity() const;
     void Set(const T& value, size_t index);
+    // Grows into spare capacity without reallocating; shrinking keeps the capacity.
     void Resize(size_t new_size);
+    // Makes room for at least new_capacity elements; never shrinks.
+    void Reserve(size_t new_capacity);
     void InsertAt(const T& value, size_t index);
 private:
     T* items;
     size_t size;
+    size_t capacity;
 
     void CheckIndex(size_t index) const;
 };
@@ -42,7 +51,7 @@ void DynamicArray<T>::CheckIndex(size_t index) const {
 }
 
 template <typename T>
-DynamicArray<T>::DynamicArray(T* items, size_t size) : size(size), items(new T[size]) {
+DynamicArray<T>::DynamicArray(T* items, size_t size) : items(new T[size]), size(size), capacity(size) {
     if (items == nullptr && size != 0) {
         throw std::invalid_argument("Nullptr with non-zero size");
     }
@@ -53,10 +62,11 @@ DynamicArray<T>::DynamicArray(T* items, size_t size) : size(size), items(new T[s
 }
 
 template <typename T>
-DynamicArray<T>::DynamicArray(size_t size) : size(size), items(new T[size]{}) {}
+DynamicArray<T>::DynamicArray(size_t size) : items(new T[size]{}), size(size), capacity(size) {}
 
 template <typename T>
-DynamicArray<T>::DynamicArray(const DynamicArray<T>& dynamic_array) : size(dynamic_array.size), items(new T[dynamic_array.size]) {
+DynamicArray<T>::DynamicArray(const DynamicArray<T>& dynamic_array)
+    : items(new T[dynamic_array.size]), size(dynamic_array.size), capacity(dynamic_array.size) {
     for (size_t i = 0; i < size; i++) {
         this->items[i] = dynamic_array.items[i];
     }
@@ -74,6 +84,7 @@ DynamicArray<T>& DynamicArray<T>::operator=(const DynamicArray& dynamic_array) {
 
         items = new_items;
         size = dynamic_array.size;
+        capacity = dynamic_array.size;
     }
 
     return *this;
@@ -86,9 +97,11 @@ DynamicArray<T>& DynamicArray<T>::operator=(DynamicArray&& dynamic_array) {
 
         items = dynamic_array.items;
         size = dynamic_array.size;
+        capacity = dynamic_array.capacity;
 
         dynamic_array.items = nullptr;
         dynamic_array.size = 0;
+        dynamic_array.capacity = 0;
     }
 
     return *this;
@@ -112,15 +125,31 @@ const T& DynamicArray<T>::Get(size_t index) const {
     return items[index];
 }
 
+template <typename T>
+T& DynamicArray<T>::At(size_t index) {
+    CheckIndex(index);
+    return items[index];
+}
+
+template <typename T>
+const T& DynamicArray<T>::At(size_t index) const {
+    CheckIndex(index);
+    return items[index];
+}
+
 template <typename T>
 T& DynamicArray<T>::operator[](size_t index) {
+#ifndef NDEBUG
     CheckIndex(index);
+#endif
     return items[index];
 }
 
 template <typename T>
 const T& DynamicArray<T>::operator[](size_t index) const {
+#ifndef NDEBUG
     CheckIndex(index);
+#endif
     return items[index];
 }
 
@@ -129,6 +158,11 @@ size_t DynamicArray<T>::GetSize() const {
     return size;
 }
 
+template <typename T>
+size_t DynamicArray<T>::GetCapacity() const {
+    return capacity;
+}
+
 template <typename T>
 void DynamicArray<T>::Set(const T& value, size_t index) {
     CheckIndex(index);
@@ -137,18 +171,33 @@ void DynamicArray<T>::Set(const T& value, size_t index) {
 
 template <typename T>
 void DynamicArray<T>::Resize(size_t new_size) {
-    T* new_items = new T[new_size]{};
+    if (new_size > capacity) {
+        Reserve(new_size);
+    }
+
+    // Slots past the old size may hold values left by an earlier shrink.
+    for (size_t i = size; i < new_size; i++) {
+        items[i] = T{};
+    }
+
+    size = new_size;
+}
+
+template <typename T>
+void DynamicArray<T>::Reserve(size_t new_capacity) {
+    if (new_capacity <= capacity) {
+        return;
+    }
 
-    size_t min_size = (size < new_size) ? size : new_size;
+    T* new_items = new T[new_capacity]{};
 
-    size_t i = 0;
-    for (i = 0; i < min_size; i++) {
+    for (size_t i = 0; i < size; i++) {
         new_items[i] = items[i];
     }
 
     delete []items;
     items = new_items;
-    size = new_size;
+    capacity = new_capacity;
 }
 
 template <typename T>
@@ -175,6 +224,7 @@ void DynamicArray<T>::InsertAt(const T& value, size_t index) {
 
     delete []items;
     items = new_items;
+    capacity = size;
 }
 
 #endif
\ No newline at end of file
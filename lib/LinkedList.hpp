@@ -2,8 +2,10 @@
 #define LINKEDLIST_HPP
 
 #include <cstddef>
+#include <new>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 
 template <typename T>
 class LinkedList {
@@ -34,6 +36,9 @@ public:
     LinkedList<T>* Concat(const LinkedList<T>* linked_list) const;
 
     void RemoveNode(size_t index);
+
+    // Makes room for count more nodes, so the next count insertions do not allocate.
+    void Reserve(size_t count);
 private:
     struct Node{
         T value;
@@ -47,7 +52,95 @@ private:
     Node* tail = nullptr;
     size_t size = 0;
 
+    // Last node reached by index, so that sequential Get(i) walks one step instead of from head.
+    mutable Node* finger = nullptr;
+    mutable size_t finger_index = 0;
+
+    // Nodes are carved out of per-list slabs; freed nodes go to an intrusive free list
+    // and are reused before a new slab is requested.
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    struct Slab {
+        Slab* next;
+        size_t capacity;
+        size_t used;
+        Node* nodes;
+    };
+
+    static const size_t MIN_SLAB_CAPACITY = 16;
+    static const size_t MAX_SLAB_CAPACITY = 4096;
+
+    Slab* slabs = nullptr;
+    FreeSlot* free_slots = nullptr;
+
     void CheckIndex(size_t index) const;
+    Node* FindNode(size_t index) const;
+
+    void AddSlab(size_t capacity);
+    void ReserveNodes(size_t count);
+    Node* AllocateNode(const T& value);
+    void FreeNode(Node* node);
+    void Clear();
+public:
+    class ConstListIterator;
+
+    class ListIterator {
+    public:
+        ListIterator(Node* node, const LinkedList<T>* list) : node(node), list(list) {}
+
+        T& operator*() const { return node->value; }
+        T* operator->() const { return &node->value; }
+
+        ListIterator& operator++() {
+            node = node->next;
+            return *this;
+        }
+
+        ListIterator& operator--() {
+            node = node ? node->prev : list->tail;
+            return *this;
+        }
+
+        bool operator==(const ListIterator& other) const { return node == other.node; }
+        bool operator!=(const ListIterator& other) const { return node != other.node; }
+    private:
+        Node* node;
+        const LinkedList<T>* list;
+
+        friend class ConstListIterator;
+    };
+
+    class ConstListIterator {
+    public:
+        ConstListIterator(const Node* node, const LinkedList<T>* list) : node(node), list(list) {}
+        ConstListIterator(const ListIterator& it) : node(it.node), list(it.list) {}
+
+        const T& operator*() const { return node->value; }
+        const T* operator->() const { return &node->value; }
+
+        ConstListIterator& operator++() {
+            node = node->next;
+            return *this;
+        }
+
+        ConstListIterator& operator--() {
+            node = node ? node->prev : list->tail;
+            return *this;
+        }
+
+        bool operator==(const ConstListIterator& other) const { return node == other.node; }
+        bool operator!=(const ConstListIterator& other) const { return node != other.node; }
+    private:
+        const Node* node;
+        const LinkedList<T>* list;
+    };
+
+    ListIterator begin() { return ListIterator(head, this); }
+    ListIterator end() { return ListIterator(nullptr, this); }
+    ConstListIterator begin() const { return ConstListIterator(head, this); }
+    ConstListIterator end() const { return ConstListIterator(nullptr, this); }
 };
 
 template <typename T>
@@ -57,12 +150,135 @@ void LinkedList<T>::CheckIndex(size_t index) const {
     }
 }
 
+template <typename T>
+typename LinkedList<T>::Node* LinkedList<T>::FindNode(size_t index) const {
+    Node* current_node;
+    size_t current_index;
+
+    size_t from_tail = size - 1 - index;
+    size_t from_finger = finger ? (index > finger_index ? index - finger_index : finger_index - index) : size;
+
+    if (from_finger <= index && from_finger <= from_tail) {
+        current_node = finger;
+        current_index = finger_index;
+    } else if (index <= from_tail) {
+        current_node = head;
+        current_index = 0;
+    } else {
+        current_node = tail;
+        current_index = size - 1;
+    }
+
+    while (current_index < index) {
+        current_node = current_node->next;
+        current_index++;
+    }
+
+    while (current_index > index) {
+        current_node = current_node->prev;
+        current_index--;
+    }
+
+    finger = current_node;
+    finger_index = index;
+
+    return current_node;
+}
+
+template <typename T>
+void LinkedList<T>::AddSlab(size_t capacity) {
+    Node* nodes = static_cast<Node*>(::operator new(capacity * sizeof(Node)));
+
+    if (slabs) {
+        while (slabs->used < slabs->capacity) {
+            free_slots = new (slabs->nodes + slabs->used) FreeSlot{free_slots};
+            slabs->used++;
+        }
+    }
+
+    slabs = new Slab{slabs, capacity, 0, nodes};
+}
+
+template <typename T>
+void LinkedList<T>::ReserveNodes(size_t count) {
+    size_t available = slabs ? slabs->capacity - slabs->used : 0;
+
+    for (FreeSlot* slot = free_slots; slot && available < count; slot = slot->next) {
+        available++;
+    }
+
+    if (available < count) {
+        AddSlab(count - available);
+    }
+}
+
+template <typename T>
+void LinkedList<T>::Reserve(size_t count) {
+    ReserveNodes(count);
+}
+
+template <typename T>
+typename LinkedList<T>::Node* LinkedList<T>::AllocateNode(const T& value) {
+    void* memory;
+
+    if (free_slots) {
+        memory = free_slots;
+        free_slots = free_slots->next;
+    } else {
+        if (!slabs || slabs->used == slabs->capacity) {
+            size_t capacity = slabs ? slabs->capacity * 2 : MIN_SLAB_CAPACITY;
+            AddSlab(capacity < MAX_SLAB_CAPACITY ? capacity : MAX_SLAB_CAPACITY);
+        }
+
+        memory = slabs->nodes + slabs->used;
+        slabs->used++;
+    }
+
+    try {
+        return new (memory) Node(value);
+    } catch (...) {
+        free_slots = new (memory) FreeSlot{free_slots};
+        throw;
+    }
+}
+
+template <typename T>
+void LinkedList<T>::FreeNode(Node* node) {
+    node->~Node();
+    free_slots = new (node) FreeSlot{free_slots};
+}
+
+template <typename T>
+void LinkedList<T>::Clear() {
+    if (!std::is_trivially_destructible<T>::value) {
+        for (Node* node = head; node; node = node->next) {
+            node->value.~T();
+        }
+    }
+
+    while (slabs) {
+        Slab* next_slab = slabs->next;
+
+        ::operator delete(slabs->nodes);
+        delete slabs;
+
+        slabs = next_slab;
+    }
+
+    head = tail = nullptr;
+    size = 0;
+    finger = nullptr;
+    free_slots = nullptr;
+}
+
 template <typename T>
 LinkedList<T>::LinkedList(T* items, size_t size) {
     if (items == nullptr && size != 0) {
         throw std::invalid_argument("Nullptr with non-zero size");
     }
 
+    ReserveNodes(size);
+
     for (size_t i = 0; i < size; i++) {
         this->Append(items[i]);
     }
@@ -70,6 +286,8 @@ LinkedList<T>::LinkedList(T* items, size_t size) {
 
 template <typename T>
 LinkedList<T>::LinkedList(const LinkedList<T>& linked_list) {
+    ReserveNodes(linked_list.size);
+
     Node* node = linked_list.head;
 
     while (node) {
@@ -82,17 +300,8 @@ LinkedList<T>::LinkedList(const LinkedList<T>& linked_list) {
 template <typename T>
 LinkedList<T>& LinkedList<T>::operator=(const LinkedList& linked_list) {
     if (this != &linked_list) {
-        Node* current_node = head;
-        while (current_node) {
-            Node* next_node = current_node->next;
-
-            delete current_node;
-
-            current_node = next_node;
-        }
-
-        head = tail = nullptr;
-        size = 0;
+        Clear();
+        ReserveNodes(linked_list.size);
 
         Node* node = linked_list.head;
         while (node) {
@@ -108,21 +317,21 @@ LinkedList<T>& LinkedList<T>::operator=(const LinkedList& linked_list) {
 template <typename T>
 LinkedList<T>& LinkedList<T>::operator=(LinkedList&& linked_list) {
     if (this != &linked_list) {
-        Node* current_node = head;
-        while (current_node) {
-            Node* next_node = current_node->next;
-
-            delete current_node;
-
-            current_node = next_node;
-        }
+        Clear();
 
         head = linked_list.head;
         tail = linked_list.tail;
         size = linked_list.size;
+        finger = linked_list.finger;
+        finger_index = linked_list.finger_index;
+        slabs = linked_list.slabs;
+        free_slots = linked_list.free_slots;
 
         linked_list.head = linked_list.tail = nullptr;
         linked_list.size = 0;
+        linked_list.finger = nullptr;
+        linked_list.slabs = nullptr;
+        linked_list.free_slots = nullptr;
     }
 
     return *this;
@@ -130,15 +339,7 @@ LinkedList<T>& LinkedList<T>::operator=(LinkedList&& linked_list) {
 
 template <typename T>
 LinkedList<T>::~LinkedList() {
-    Node* current_node = head;
-
-    while (current_node) {
-        Node* next_node = current_node->next;
-
-        delete current_node;
-
-        current_node = next_node;
-    }
+    Clear();
 }
 
 template <typename T>
@@ -163,26 +364,14 @@ template <typename T>
 T& LinkedList<T>::Get(size_t index) {
     CheckIndex(index);
 
-    Node* current_node = head;
-
-    for (size_t i = 0; i < index; i++) {
-        current_node = current_node->next;
-    }
-
-    return current_node->value;
+    return FindNode(index)->value;
 }
 
 template <typename T>
 const T& LinkedList<T>::Get(size_t index) const {
     CheckIndex(index);
 
-    Node* current_node = head;
-
-    for (size_t i = 0; i < index; i++) {
-        current_node = current_node->next;
-    }
-
-    return current_node->value;
+    return FindNode(index)->value;
 }
 
 template <typename T>
@@ -207,8 +396,10 @@ LinkedList<T>* LinkedList<T>::GetSubList(size_t start_index, size_t end_index) c
 
     LinkedList<T>* sub_linked_list = new LinkedList<T>();
 
+    Node* node = FindNode(start_index);
     for (size_t i = start_index; i <= end_index; ++i) {
-        sub_linked_list->Append(this->Get(i));
+        sub_linked_list->Append(node->value);
+        node = node->next;
     }
     
     return sub_linked_list;
@@ -221,7 +412,7 @@ size_t LinkedList<T>::GetSize() const {
 
 template <typename T>
 void LinkedList<T>::Append(const T& value) {
-    Node* node = new Node(value);
+    Node* node = AllocateNode(value);
 
     if (!tail) {
         head = tail = node;
@@ -236,7 +427,7 @@ void LinkedList<T>::Append(const T& value) {
 
 template <typename T>
 void LinkedList<T>::Prepend(const T& value) {
-    Node* node = new Node(value);
+    Node* node = AllocateNode(value);
 
     if (!tail) {
         head = tail = node;
@@ -246,6 +437,10 @@ void LinkedList<T>::Prepend(const T& value) {
         head = node;
     }
 
+    if (finger) {
+        finger_index++;
+    }
+
     size++;
 }
 
@@ -260,33 +455,20 @@ void LinkedList<T>::InsertAt(const T& value, size_t index) {
     } else if (index == size) {
         Append(value);
     } else {
-        Node* node = new Node(value);
-        Node* current_node;
-
-        if (index < size - index) {
-            current_node = head;
+        Node* current_node = FindNode(index);
+        Node* node = AllocateNode(value);
 
-            for (size_t i = 0; i < index; i++) {
-                current_node = current_node->next;
-            }
-        } else {
-            current_node = tail;
+        node->next = current_node;
+        node->prev = current_node->prev;
 
-            for (size_t i = 0; i < index; i++) {
-                current_node = current_node->prev;
-            }
+        if (current_node->prev) {
+            current_node->prev->next = node;
         }
 
-    node->next = current_node;
-    node->prev = current_node->prev;
+        current_node->prev = node;
 
-    if (current_node->prev) {
-        current_node->prev->next = node;
-    }
-
-    current_node->prev = node;
-
-    size++;
+        finger = node;
+        size++;
     }
 }
 
@@ -297,6 +479,7 @@ LinkedList<T>* LinkedList<T>::Concat(const LinkedList<T>* linked_list) const {
     }
     
     LinkedList<T>* concat_linked_list = new LinkedList<T>(*this);
+    concat_linked_list->ReserveNodes(linked_list->size);
 
     Node* node = linked_list->head;
 
@@ -312,19 +495,7 @@ template <typename T>
 void LinkedList<T>::RemoveNode(size_t index) {
     CheckIndex(index);
 
-    Node* current_node = nullptr;
-
-    if (index < size - index) {
-        current_node = head;
-        for (size_t i = 0; i < index; i++) {
-            current_node = current_node->next;
-        }
-    } else {
-        current_node = tail;
-        for (size_t i = size - 1; i > index; --i) {
-            current_node = current_node->prev;
-        }
-    }
+    Node* current_node = FindNode(index);
 
     if (current_node->prev) {
         current_node->prev->next = current_node->next;
@@ -338,7 +509,14 @@ void LinkedList<T>::RemoveNode(size_t index) {
         tail = current_node->prev;
     }
 
-    delete current_node;
+    finger = current_node->next;
+
+    if (!finger && current_node->prev) {
+        finger = current_node->prev;
+        finger_index = index - 1;
+    }
+
+    FreeNode(current_node);
     size--;
 }
 
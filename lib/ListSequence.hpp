@@ -18,11 +18,11 @@ public:
 
     ~ListSequence();
 
-    T& GetFirst() override;
+    T& GetFirst();
     const T& GetFirst() const override;
-    T& GetLast() override;
+    T& GetLast();
     const T& GetLast() const override;
-    T& Get(size_t index) override;
+    T& Get(size_t index);
     const T& Get(size_t index) const override;
 
     T& operator[](size_t index);
@@ -37,6 +37,15 @@ public:
     ListSequence<T>* Concat(const Sequence<T>* list_sequence) const override;
 
     void RemoveNode(size_t index);
+    void Reserve(size_t count);
+
+    using ListIterator = typename LinkedList<T>::ListIterator;
+    using ConstListIterator = typename LinkedList<T>::ConstListIterator;
+
+    ListIterator begin() { return items->begin(); }
+    ListIterator end() { return items->end(); }
+    ConstListIterator begin() const { return static_cast<const LinkedList<T>*>(items)->begin(); }
+    ConstListIterator end() const { return static_cast<const LinkedList<T>*>(items)->end(); }
 private:
     LinkedList<T>* items;
 };
@@ -180,4 +189,9 @@ void ListSequence<T>::RemoveNode(size_t index) {
     items->RemoveNode(index);
 }
 
+template <typename T>
+void ListSequence<T>::Reserve(size_t count) {
+    items->Reserve(count);
+}
+
 #endif
\ No newline at end of file
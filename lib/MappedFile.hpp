@@ -0,0 +1,94 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped, elsewhere it
+// is read into memory once.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+private:
+    const char* data;
+    size_t size;
+#ifdef _WIN32
+    std::vector<char> buffer;
+#else
+    void* mapping;
+#endif
+};
+
+#ifdef _WIN32
+
+inline MappedFile::MappedFile(const std::string& path) : data(nullptr), size(0) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+    buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+}
+
+inline MappedFile::~MappedFile() {}
+
+#else
+
+inline MappedFile::MappedFile(const std::string& path) : data(nullptr), size(0), mapping(nullptr) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0) {
+        close(descriptor);
+        throw std::runtime_error("Cannot stat file: " + path);
+    }
+
+    size = static_cast<size_t>(status.st_size);
+
+    if (size > 0) {
+        mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+        if (mapping == MAP_FAILED) {
+            close(descriptor);
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapping);
+    }
+
+    close(descriptor);
+}
+
+inline MappedFile::~MappedFile() {
+    if (mapping) {
+        munmap(mapping, size);
+    }
+}
+
+#endif
+
+#endif
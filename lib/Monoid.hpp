@@ -0,0 +1,76 @@
+#ifndef MONOID_HPP
+#define MONOID_HPP
+
+#include <cstddef>
+#include <limits>
+
+// A monoid describes how to summarize a run of elements: Lift turns one element into a
+// summary, Combine joins the summaries of two adjacent runs (left before right) and
+// Identity is the summary of an empty run. Combine must be associative, not commutative.
+
+template <typename T>
+struct SumMonoid {
+    using Value = T;
+
+    static Value Identity() { return T(); }
+    static Value Lift(const T& value) { return value; }
+    static Value Combine(const Value& left, const Value& right) { return left + right; }
+};
+
+template <typename T>
+struct MinMonoid {
+    using Value = T;
+
+    static Value Identity() { return std::numeric_limits<T>::max(); }
+    static Value Lift(const T& value) { return value; }
+    static Value Combine(const Value& left, const Value& right) { return right < left ? right : left; }
+};
+
+template <typename T>
+struct MaxMonoid {
+    using Value = T;
+
+    static Value Identity() { return std::numeric_limits<T>::lowest(); }
+    static Value Lift(const T& value) { return value; }
+    static Value Combine(const Value& left, const Value& right) { return left < right ? right : left; }
+};
+
+template <typename T>
+struct CountMonoid {
+    using Value = size_t;
+
+    static Value Identity() { return 0; }
+    static Value Lift(const T&) { return 1; }
+    static Value Combine(const Value& left, const Value& right) { return left + right; }
+};
+
+template <typename T>
+struct Stats {
+    size_t count;
+    T sum;
+    T min;
+    T max;
+};
+
+// Count, sum, min and max in one pass.
+template <typename T>
+struct StatsMonoid {
+    using Value = Stats<T>;
+
+    static Value Identity() {
+        return Value{0, T(), std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()};
+    }
+
+    static Value Lift(const T& value) {
+        return Value{1, value, value, value};
+    }
+
+    static Value Combine(const Value& left, const Value& right) {
+        return Value{left.count + right.count,
+                     left.sum + right.sum,
+                     MinMonoid<T>::Combine(left.min, right.min),
+                     MaxMonoid<T>::Combine(left.max, right.max)};
+    }
+};
+
+#endif
@@ -0,0 +1,356 @@
+#ifndef PERSISTENTVECTOR_HPP
+#define PERSISTENTVECTOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "DynamicArray.hpp"
+
+// Persistent vector: a height-balanced tree whose leaves hold up to CHUNK_SIZE elements.
+// Copies share the whole tree; every update copies only the O(log n) nodes on its path,
+// so older versions stay valid and unchanged. Concat and GetSubVector work by joining and
+// splitting trees instead of copying elements.
+template <typename T>
+class PersistentVector {
+public:
+    static const size_t CHUNK_SIZE = 32;
+
+    PersistentVector() = default;
+    PersistentVector(T* items, size_t size);
+    PersistentVector(size_t size);
+
+    const T& Get(size_t index) const;
+    size_t GetSize() const;
+
+    PersistentVector<T> Set(const T& value, size_t index) const;
+    PersistentVector<T> Append(const T& value) const;
+    PersistentVector<T> Prepend(const T& value) const;
+    PersistentVector<T> InsertAt(const T& value, size_t index) const;
+    PersistentVector<T> Concat(const PersistentVector<T>& vector) const;
+    PersistentVector<T> GetSubVector(size_t start_index, size_t end_index) const;
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<Node>;
+
+    struct Node {
+        size_t size;
+        int height;
+        NodePtr left;
+        NodePtr right;
+        DynamicArray<T>* items;
+
+        Node(DynamicArray<T>* leaf_items) : size(leaf_items->GetSize()), height(0), items(leaf_items) {}
+        Node(NodePtr left_node, NodePtr right_node)
+            : size(left_node->size + right_node->size),
+              height(1 + (left_node->height > right_node->height ? left_node->height : right_node->height)),
+              left(std::move(left_node)), right(std::move(right_node)), items(nullptr) {}
+        Node(const Node& node)
+            : size(node.size), height(node.height), left(node.left), right(node.right),
+              items(node.items ? new DynamicArray<T>(*node.items) : nullptr) {}
+
+        Node& operator=(const Node&) = delete;
+
+        ~Node() {
+            delete items;
+        }
+
+        bool IsLeaf() const {
+            return items != nullptr;
+        }
+    };
+
+    NodePtr root;
+
+    explicit PersistentVector(NodePtr root) : root(std::move(root)) {}
+
+    void CheckIndex(size_t index) const;
+
+    static int Height(const NodePtr& node);
+    static size_t Size(const NodePtr& node);
+
+    static NodePtr MakeLeaf(const T& value);
+    static NodePtr MakeBranch(NodePtr left, NodePtr right);
+    static NodePtr Balance(NodePtr left, NodePtr right);
+    static NodePtr Join(NodePtr left, NodePtr right);
+    static std::pair<NodePtr, NodePtr> Split(const NodePtr& node, size_t index);
+    static NodePtr Build(T* items, size_t size);
+
+    static NodePtr SetAt(const NodePtr& node, const T& value, size_t index);
+    static NodePtr InsertInto(const NodePtr& node, const T& value, size_t index);
+};
+
+template <typename T>
+PersistentVector<T>::PersistentVector(T* items, size_t size) {
+    if (items == nullptr && size != 0) {
+        throw std::invalid_argument("Nullptr with non-zero size");
+    }
+
+    root = Build(items, size);
+}
+
+template <typename T>
+PersistentVector<T>::PersistentVector(size_t size) {
+    DynamicArray<T> items(size);
+
+    if (size != 0) {
+        root = Build(&items[0], size);
+    }
+}
+
+template <typename T>
+void PersistentVector<T>::CheckIndex(size_t index) const {
+    if (index >= Size(root)) {
+        throw std::out_of_range("Index " + std::to_string(index) + " is out of range");
+    }
+}
+
+template <typename T>
+int PersistentVector<T>::Height(const NodePtr& node) {
+    return node ? node->height : -1;
+}
+
+template <typename T>
+size_t PersistentVector<T>::Size(const NodePtr& node) {
+    return node ? node->size : 0;
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::MakeLeaf(const T& value) {
+    DynamicArray<T>* items = new DynamicArray<T>(1);
+    (*items)[0] = value;
+
+    return std::make_shared<Node>(items);
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::MakeBranch(NodePtr left, NodePtr right) {
+    return std::make_shared<Node>(std::move(left), std::move(right));
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::Balance(NodePtr left, NodePtr right) {
+    if (Height(left) > Height(right) + 1) {
+        if (Height(left->left) >= Height(left->right)) {
+            return MakeBranch(left->left, MakeBranch(left->right, std::move(right)));
+        }
+
+        return MakeBranch(MakeBranch(left->left, left->right->left), MakeBranch(left->right->right, std::move(right)));
+    }
+
+    if (Height(right) > Height(left) + 1) {
+        if (Height(right->right) >= Height(right->left)) {
+            return MakeBranch(MakeBranch(std::move(left), right->left), right->right);
+        }
+
+        return MakeBranch(MakeBranch(std::move(left), right->left->left), MakeBranch(right->left->right, right->right));
+    }
+
+    return MakeBranch(std::move(left), std::move(right));
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::Join(NodePtr left, NodePtr right) {
+    if (!left) {
+        return right;
+    }
+
+    if (!right) {
+        return left;
+    }
+
+    if (left->IsLeaf() && right->IsLeaf() && left->size + right->size <= CHUNK_SIZE) {
+        DynamicArray<T>* items = new DynamicArray<T>(left->size + right->size);
+
+        for (size_t i = 0; i < left->size; i++) {
+            (*items)[i] = (*left->items)[i];
+        }
+
+        for (size_t i = 0; i < right->size; i++) {
+            (*items)[left->size + i] = (*right->items)[i];
+        }
+
+        return std::make_shared<Node>(items);
+    }
+
+    if (Height(left) > Height(right) + 1) {
+        return Balance(left->left, Join(left->right, std::move(right)));
+    }
+
+    if (Height(right) > Height(left) + 1) {
+        return Balance(Join(std::move(left), right->left), right->right);
+    }
+
+    return MakeBranch(std::move(left), std::move(right));
+}
+
+template <typename T>
+std::pair<typename PersistentVector<T>::NodePtr, typename PersistentVector<T>::NodePtr>
+PersistentVector<T>::Split(const NodePtr& node, size_t index) {
+    if (!node || index == 0) {
+        return {nullptr, node};
+    }
+
+    if (index >= node->size) {
+        return {node, nullptr};
+    }
+
+    if (node->IsLeaf()) {
+        NodePtr left = Build(&(*node->items)[0], index);
+        NodePtr right = Build(&(*node->items)[index], node->size - index);
+
+        return {left, right};
+    }
+
+    size_t left_size = node->left->size;
+
+    if (index < left_size) {
+        std::pair<NodePtr, NodePtr> parts = Split(node->left, index);
+        return {parts.first, Join(parts.second, node->right)};
+    }
+
+    if (index == left_size) {
+        return {node->left, node->right};
+    }
+
+    std::pair<NodePtr, NodePtr> parts = Split(node->right, index - left_size);
+    return {Join(node->left, parts.first), parts.second};
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::Build(T* items, size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    if (size <= CHUNK_SIZE) {
+        return std::make_shared<Node>(new DynamicArray<T>(items, size));
+    }
+
+    size_t chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    size_t left_size = (chunks / 2) * CHUNK_SIZE;
+
+    return MakeBranch(Build(items, left_size), Build(items + left_size, size - left_size));
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::SetAt(const NodePtr& node, const T& value, size_t index) {
+    NodePtr copy = std::make_shared<Node>(*node);
+
+    if (copy->IsLeaf()) {
+        (*copy->items)[index] = value;
+    } else if (index < copy->left->size) {
+        copy->left = SetAt(copy->left, value, index);
+    } else {
+        copy->right = SetAt(copy->right, value, index - copy->left->size);
+    }
+
+    return copy;
+}
+
+template <typename T>
+typename PersistentVector<T>::NodePtr PersistentVector<T>::InsertInto(const NodePtr& node, const T& value, size_t index) {
+    if (!node) {
+        return MakeLeaf(value);
+    }
+
+    if (!node->IsLeaf()) {
+        if (index < node->left->size) {
+            return Balance(InsertInto(node->left, value, index), node->right);
+        }
+
+        return Balance(node->left, InsertInto(node->right, value, index - node->left->size));
+    }
+
+    if (node->size < CHUNK_SIZE) {
+        DynamicArray<T>* items = new DynamicArray<T>(*node->items);
+        items->InsertAt(value, index);
+
+        return std::make_shared<Node>(items);
+    }
+
+    // A full leaf at either end gets a fresh neighbour so that appends keep leaves packed.
+    if (index == node->size) {
+        return MakeBranch(node, MakeLeaf(value));
+    }
+
+    if (index == 0) {
+        return MakeBranch(MakeLeaf(value), node);
+    }
+
+    std::pair<NodePtr, NodePtr> halves = Split(node, node->size / 2);
+
+    if (index < halves.first->size) {
+        return MakeBranch(InsertInto(halves.first, value, index), halves.second);
+    }
+
+    return MakeBranch(halves.first, InsertInto(halves.second, value, index - halves.first->size));
+}
+
+template <typename T>
+const T& PersistentVector<T>::Get(size_t index) const {
+    CheckIndex(index);
+
+    const Node* node = root.get();
+
+    while (!node->IsLeaf()) {
+        if (index < node->left->size) {
+            node = node->left.get();
+        } else {
+            index -= node->left->size;
+            node = node->right.get();
+        }
+    }
+
+    return (*node->items)[index];
+}
+
+template <typename T>
+size_t PersistentVector<T>::GetSize() const {
+    return Size(root);
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::Set(const T& value, size_t index) const {
+    CheckIndex(index);
+
+    return PersistentVector<T>(SetAt(root, value, index));
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::Append(const T& value) const {
+    return PersistentVector<T>(InsertInto(root, value, Size(root)));
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::Prepend(const T& value) const {
+    return PersistentVector<T>(InsertInto(root, value, 0));
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::InsertAt(const T& value, size_t index) const {
+    if (index != Size(root)) {
+        CheckIndex(index);
+    }
+
+    return PersistentVector<T>(InsertInto(root, value, index));
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::Concat(const PersistentVector<T>& vector) const {
+    return PersistentVector<T>(Join(root, vector.root));
+}
+
+template <typename T>
+PersistentVector<T> PersistentVector<T>::GetSubVector(size_t start_index, size_t end_index) const {
+    if (start_index > end_index || end_index >= Size(root)) {
+        throw std::out_of_range("Indexes from " + std::to_string(start_index) + " to " + std::to_string(end_index) + " are out of range");
+    }
+
+    NodePtr prefix = Split(root, end_index + 1).first;
+
+    return PersistentVector<T>(Split(prefix, start_index).second);
+}
+
+#endif
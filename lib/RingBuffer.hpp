@@ -0,0 +1,280 @@
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Growable circular buffer with O(1) push/pop at both ends and O(1) indexing.
+// The first InlineCapacity slots live inside the object, so a buffer that never
+// holds more than that many elements does not allocate.
+template <typename T, size_t InlineCapacity = 0>
+class RingBuffer {
+    static_assert((InlineCapacity & (InlineCapacity - 1)) == 0, "InlineCapacity must be zero or a power of two");
+public:
+    RingBuffer();
+    RingBuffer(const RingBuffer<T, InlineCapacity>& ring_buffer);
+    RingBuffer(RingBuffer<T, InlineCapacity>&& ring_buffer);
+
+    RingBuffer& operator=(const RingBuffer& ring_buffer);
+    RingBuffer& operator=(RingBuffer&& ring_buffer);
+
+    ~RingBuffer();
+
+    T& Get(size_t index);
+    const T& Get(size_t index) const;
+
+    // Bounds are checked only in debug builds (without NDEBUG).
+    T& operator[](size_t index);
+    const T& operator[](size_t index) const;
+
+    T& GetFirst();
+    const T& GetFirst() const;
+    T& GetLast();
+    const T& GetLast() const;
+
+    size_t GetSize() const;
+    size_t GetCapacity() const;
+    bool IsEmpty() const;
+
+    void PushBack(const T& value);
+    void PushFront(const T& value);
+    void PopBack();
+    void PopFront();
+    void Clear();
+    void Reserve(size_t capacity);
+private:
+    T inline_items[InlineCapacity > 0 ? InlineCapacity : 1];
+    T* items;
+    size_t capacity;
+    size_t head;
+    size_t size;
+
+    void CheckIndex(size_t index) const;
+    void Grow(size_t new_capacity);
+    size_t Slot(size_t index) const;
+};
+
+template <typename T, size_t InlineCapacity>
+RingBuffer<T, InlineCapacity>::RingBuffer()
+    : items(InlineCapacity > 0 ? inline_items : nullptr), capacity(InlineCapacity), head(0), size(0) {}
+
+template <typename T, size_t InlineCapacity>
+RingBuffer<T, InlineCapacity>::RingBuffer(const RingBuffer<T, InlineCapacity>& ring_buffer) : RingBuffer() {
+    Reserve(ring_buffer.size);
+
+    for (size_t i = 0; i < ring_buffer.size; i++) {
+        PushBack(ring_buffer[i]);
+    }
+}
+
+template <typename T, size_t InlineCapacity>
+RingBuffer<T, InlineCapacity>::RingBuffer(RingBuffer<T, InlineCapacity>&& ring_buffer) : RingBuffer() {
+    *this = std::move(ring_buffer);
+}
+
+template <typename T, size_t InlineCapacity>
+RingBuffer<T, InlineCapacity>& RingBuffer<T, InlineCapacity>::operator=(const RingBuffer& ring_buffer) {
+    if (this != &ring_buffer) {
+        Clear();
+        Reserve(ring_buffer.size);
+
+        for (size_t i = 0; i < ring_buffer.size; i++) {
+            PushBack(ring_buffer[i]);
+        }
+    }
+
+    return *this;
+}
+
+template <typename T, size_t InlineCapacity>
+RingBuffer<T, InlineCapacity>& RingBuffer<T, InlineCapacity>::operator=(RingBuffer&& ring_buffer) {
+    if (this != &ring_buffer) {
+        Clear();
+
+        if (ring_buffer.items == ring_buffer.inline_items) {
+            for (size_t i = 0; i < ring_buffer.size; i++) {
+                PushBack(std::move(ring_buffer[i]));
+            }
+            ring_buffer.Clear();
+        } else {
+            if (items != inline_items) {
+                delete[] items;
+            }
+
+            items = ring_buffer.items;
+            capacity = ring_buffer.capacity;
+            head = ring_buffer.head;
+            size = ring_buffer.size;
+
+            ring_buffer.items = InlineCapacity > 0 ? ring_buffer.inline_items : nullptr;
+            ring_buffer.capacity = InlineCapacity;
+            ring_buffer.head = 0;
+            ring_buffer.size = 0;
+        }
+    }
+
+    return *this;
+}
+
+template <typename T, size_t InlineCapacity>
+RingBuffer<T, InlineCapacity>::~RingBuffer() {
+    if (items != inline_items) {
+        delete[] items;
+    }
+}
+
+template <typename T, size_t InlineCapacity>
+void RingBuffer<T, InlineCapacity>::CheckIndex(size_t index) const {
+    if (index >= size) {
+        throw std::out_of_range("Index " + std::to_string(index) + " is out of range");
+    }
+}
+
+template <typename T, size_t InlineCapacity>
+size_t RingBuffer<T, InlineCapacity>::Slot(size_t index) const {
+    return (head + index) & (capacity - 1);
+}
+
+template <typename T, size_t InlineCapacity>
+void RingBuffer<T, InlineCapacity>::Grow(size_t new_capacity) {
+    T* new_items = new T[new_capacity];
+
+    for (size_t i = 0; i < size; i++) {
+        new_items[i] = std::move(items[Slot(i)]);
+    }
+
+    if (items != inline_items) {
+        delete[] items;
+    }
+
+    items = new_items;
+    capacity = new_capacity;
+    head = 0;
+}
+
+template <typename T, size_t InlineCapacity>
+T& RingBuffer<T, InlineCapacity>::Get(size_t index) {
+    CheckIndex(index);
+    return items[Slot(index)];
+}
+
+template <typename T, size_t InlineCapacity>
+const T& RingBuffer<T, InlineCapacity>::Get(size_t index) const {
+    CheckIndex(index);
+    return items[Slot(index)];
+}
+
+template <typename T, size_t InlineCapacity>
+T& RingBuffer<T, InlineCapacity>::operator[](size_t index) {
+#ifndef NDEBUG
+    CheckIndex(index);
+#endif
+    return items[Slot(index)];
+}
+
+template <typename T, size_t InlineCapacity>
+const T& RingBuffer<T, InlineCapacity>::operator[](size_t index) const {
+#ifndef NDEBUG
+    CheckIndex(index);
+#endif
+    return items[Slot(index)];
+}
+
+template <typename T, size_t InlineCapacity>
+T& RingBuffer<T, InlineCapacity>::GetFirst() {
+    return Get(0);
+}
+
+template <typename T, size_t InlineCapacity>
+const T& RingBuffer<T, InlineCapacity>::GetFirst() const {
+    return Get(0);
+}
+
+template <typename T, size_t InlineCapacity>
+T& RingBuffer<T, InlineCapacity>::GetLast() {
+    return Get(size - 1);
+}
+
+template <typename T, size_t InlineCapacity>
+const T& RingBuffer<T, InlineCapacity>::GetLast() const {
+    return Get(size - 1);
+}
+
+template <typename T, size_t InlineCapacity>
+size_t RingBuffer<T, InlineCapacity>::GetSize() const {
+    return size;
+}
+
+template <typename T, size_t InlineCapacity>
+size_t RingBuffer<T, InlineCapacity>::GetCapacity() const {
+    return capacity;
+}
+
+template <typename T, size_t InlineCapacity>
+bool RingBuffer<T, InlineCapacity>::IsEmpty() const {
+    return size == 0;
+}
+
+template <typename T, size_t InlineCapacity>
+void RingBuffer<T, InlineCapacity>::PushBack(const T& value) {
+    if (size == capacity) {
+        Grow(capacity < 4 ? 8 : capacity * 2);
+    }
+
+    items[Slot(size)] = value;
+    size++;
+}
+
+template <typename T, size_t InlineCapacity>
+void RingBuffer<T, InlineCapacity>::PushFront(const T& value) {
+    if (size == capacity) {
+        Grow(capacity < 4 ? 8 : capacity * 2);
+    }
+
+    head = (head + capacity - 1) & (capacity - 1);
+    items[head] = value;
+    size++;
+}
+
+template <typename T, size_t InlineCapacity>
+void RingBuffer<T, InlineCapacity>::PopBack() {
+    if (size == 0) {
+        throw std::out_of_range("PopBack from empty ring buffer");
+    }
+
+    size--;
+}
+
+template <typename T, size_t InlineCapacity>
+void RingBuffer<T, InlineCapacity>::PopFront() {
+    if (size == 0) {
+        throw std::out_of_range("PopFront from empty ring buffer");
+    }
+
+    head = (head + 1) & (capacity - 1);
+    size--;
+}
+
+template <typename T, size_t InlineCapacity>
+void RingBuffer<T, InlineCapacity>::Clear() {
+    head = 0;
+    size = 0;
+}
+
+template <typename T, size_t InlineCapacity>
+void RingBuffer<T, InlineCapacity>::Reserve(size_t new_capacity) {
+    if (new_capacity <= capacity) {
+        return;
+    }
+
+    size_t rounded = capacity < 8 ? 8 : capacity;
+    while (rounded < new_capacity) {
+        rounded *= 2;
+    }
+
+    Grow(rounded);
+}
+
+#endif
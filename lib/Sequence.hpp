@@ -6,11 +6,10 @@ class Sequence {
 public:
     virtual ~Sequence() = default;
 
-    virtual T& GetFirst() = 0;
+    // Element access through the interface is read-only; mutable sequences add
+    // non-const overloads of their own, immutable ones do not.
     virtual const T& GetFirst() const = 0;
-    virtual T& GetLast() = 0;
     virtual const T& GetLast() const = 0;
-    virtual T& Get(size_t index) = 0;
     virtual const T& Get(size_t index) const = 0;
     virtual Sequence<T>* GetSubsequence(size_t start_index, size_t end_index) const = 0;
     virtual size_t GetSize() const = 0;
@@ -0,0 +1,77 @@
+#ifndef STATICSEQUENCE_HPP
+#define STATICSEQUENCE_HPP
+
+#include <cstddef>
+#include <stdexcept>
+
+// Compile-time counterpart of Sequence<T>. Derived provides GetSize() and operator[];
+// everything here is resolved statically, so element access inlines into the caller.
+template <typename Derived, typename T>
+class StaticSequence {
+public:
+    T& GetFirst() {
+        CheckNotEmpty();
+        return Self()[0];
+    }
+
+    const T& GetFirst() const {
+        CheckNotEmpty();
+        return Self()[0];
+    }
+
+    T& GetLast() {
+        CheckNotEmpty();
+        return Self()[Self().GetSize() - 1];
+    }
+
+    const T& GetLast() const {
+        CheckNotEmpty();
+        return Self()[Self().GetSize() - 1];
+    }
+
+    bool IsEmpty() const {
+        return Self().GetSize() == 0;
+    }
+
+    template <typename Func>
+    void ForEach(Func func) {
+        Derived& self = Self();
+        size_t size = self.GetSize();
+
+        for (size_t i = 0; i < size; i++) {
+            func(self[i]);
+        }
+    }
+
+    template <typename Func>
+    void ForEach(Func func) const {
+        const Derived& self = Self();
+        size_t size = self.GetSize();
+
+        for (size_t i = 0; i < size; i++) {
+            func(self[i]);
+        }
+    }
+
+    template <typename Func, typename Accumulator>
+    Accumulator Reduce(Func func, Accumulator init) const {
+        Self().ForEach([&](const T& value) { init = func(init, value); });
+        return init;
+    }
+protected:
+    Derived& Self() {
+        return static_cast<Derived&>(*this);
+    }
+
+    const Derived& Self() const {
+        return static_cast<const Derived&>(*this);
+    }
+private:
+    void CheckNotEmpty() const {
+        if (Self().GetSize() == 0) {
+            throw std::out_of_range("Sequence is empty");
+        }
+    }
+};
+
+#endif
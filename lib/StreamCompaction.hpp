@@ -0,0 +1,115 @@
+#ifndef STREAMCOMPACTION_HPP
+#define STREAMCOMPACTION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Branch-free compaction of blocks of BLOCK_SIZE elements: bit j of mask keeps source[j].
+// The survivors are written to the front of destination, which must have room for a whole
+// block, because every lane is stored and only the kept ones are counted.
+class StreamCompaction {
+public:
+    static const size_t BLOCK_SIZE = 8;
+    // Elements covered by one mask, i.e. MASK_SIZE / BLOCK_SIZE compressed blocks.
+    static const size_t MASK_SIZE = 32;
+
+    // Whether CompressBlock has a SIMD version for T. Without one, compaction loses to a
+    // plain branch per element when few elements survive.
+    template <typename T>
+    static constexpr bool HasSimdCompress() {
+#if defined(__AVX2__)
+        return sizeof(T) == 4;
+#else
+        return false;
+#endif
+    }
+
+    // Evaluates predicate on source[0..MASK_SIZE) and packs the results into a bit mask.
+    // The fixed trip count, 32-bit shifts and lack of early exits let the compiler
+    // vectorize both the predicate and the packing.
+    template <typename T, typename Predicate>
+    static uint32_t Mask(const T* source, Predicate& predicate) {
+        uint32_t mask = 0;
+
+        for (uint32_t j = 0; j < MASK_SIZE; j++) {
+            mask |= static_cast<uint32_t>(static_cast<bool>(predicate(source[j]))) << j;
+        }
+
+        return mask;
+    }
+
+    // Same for a partial run of count < MASK_SIZE elements.
+    template <typename T, typename Predicate>
+    static uint32_t Mask(const T* source, size_t count, Predicate& predicate) {
+        uint32_t mask = 0;
+
+        for (size_t j = 0; j < count; j++) {
+            mask |= static_cast<uint32_t>(static_cast<bool>(predicate(source[j]))) << j;
+        }
+
+        return mask;
+    }
+
+    // Stores the kept elements of a full block and returns their count.
+    template <typename T>
+    static size_t CompressBlock(const T* source, unsigned mask, T* destination) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+        if constexpr (sizeof(T) == 4) {
+            __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+            _mm256_mask_compressstoreu_epi32(destination, static_cast<__mmask8>(mask), values);
+            return PopCount(mask);
+        }
+#elif defined(__AVX2__)
+        if constexpr (sizeof(T) == 4) {
+            static constexpr ShuffleTable table;
+            __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+            __m256i order = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.indices[mask]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), _mm256_permutevar8x32_epi32(values, order));
+            return PopCount(mask);
+        }
+#endif
+        return Compress(source, BLOCK_SIZE, mask, destination);
+    }
+
+    // Scalar version for any element type and a partial block of count elements.
+    template <typename T>
+    static size_t Compress(const T* source, size_t count, uint32_t mask, T* destination) {
+        size_t kept = 0;
+
+        for (size_t j = 0; j < count; j++) {
+            destination[kept] = source[j];
+            kept += (mask >> j) & 1;
+        }
+
+        return kept;
+    }
+private:
+    static size_t PopCount(unsigned mask) {
+        mask = mask - ((mask >> 1) & 0x55);
+        mask = (mask & 0x33) + ((mask >> 2) & 0x33);
+        return static_cast<size_t>((mask + (mask >> 4)) & 0x0F);
+    }
+
+    // For every 8-bit mask, the lane indices of its set bits in order, padded with zeros.
+    struct ShuffleTable {
+        uint32_t indices[1 << BLOCK_SIZE][BLOCK_SIZE];
+
+        constexpr ShuffleTable() : indices() {
+            for (unsigned mask = 0; mask < (1u << BLOCK_SIZE); mask++) {
+                size_t kept = 0;
+
+                for (uint32_t lane = 0; lane < BLOCK_SIZE; lane++) {
+                    if (mask & (1u << lane)) {
+                        indices[mask][kept++] = lane;
+                    }
+                }
+            }
+        }
+    };
+};
+
+#endif
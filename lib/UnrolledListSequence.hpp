@@ -0,0 +1,483 @@
+#ifndef UNROLLEDLISTSEQUENCE_HPP
+#define UNROLLEDLISTSEQUENCE_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include "Sequence.hpp"
+
+// Doubly linked list of nodes that each hold up to NodeCapacity elements in place.
+// A full node is split in half on insert; a node that falls below half capacity
+// after a removal is merged with its successor when both fit into one node.
+template <typename T, size_t NodeCapacity = 32>
+class UnrolledListSequence : public Sequence<T> {
+    static_assert(NodeCapacity >= 2, "NodeCapacity must be at least 2");
+public:
+    UnrolledListSequence() = default;
+    UnrolledListSequence(T* items, size_t size);
+    UnrolledListSequence(const UnrolledListSequence<T, NodeCapacity>& list_sequence);
+
+    UnrolledListSequence& operator=(const UnrolledListSequence& list_sequence);
+    UnrolledListSequence& operator=(UnrolledListSequence&& list_sequence);
+
+    ~UnrolledListSequence();
+
+    T& GetFirst();
+    const T& GetFirst() const override;
+    T& GetLast();
+    const T& GetLast() const override;
+    T& Get(size_t index);
+    const T& Get(size_t index) const override;
+
+    T& operator[](size_t index);
+    const T& operator[](size_t index) const;
+
+    UnrolledListSequence<T, NodeCapacity>* GetSubsequence(size_t start_index, size_t end_index) const override;
+    size_t GetSize() const override;
+    size_t GetNodeCount() const;
+
+    void Append(const T& value) override;
+    void Prepend(const T& value) override;
+    void InsertAt(const T& value, size_t index) override;
+    UnrolledListSequence<T, NodeCapacity>* Concat(const Sequence<T>* sequence) const override;
+
+    void RemoveNode(size_t index);
+private:
+    struct Node {
+        T items[NodeCapacity];
+        size_t count = 0;
+        Node* next = nullptr;
+        Node* prev = nullptr;
+    };
+
+    Node* head = nullptr;
+    Node* tail = nullptr;
+    size_t size = 0;
+    size_t node_count = 0;
+
+    // Node that contained the last looked-up index and the index of its first element.
+    mutable Node* finger = nullptr;
+    mutable size_t finger_start = 0;
+
+    void CheckIndex(size_t index) const;
+    Node* FindNode(size_t& index) const;
+    Node* InsertNodeAfter(Node* node);
+    void UnlinkNode(Node* node);
+    void Clear();
+public:
+    class ListIterator {
+    public:
+        ListIterator(Node* node, size_t offset) : node(node), offset(offset) {}
+
+        T& operator*() const { return node->items[offset]; }
+        T* operator->() const { return &node->items[offset]; }
+
+        ListIterator& operator++() {
+            if (++offset == node->count) {
+                node = node->next;
+                offset = 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const ListIterator& other) const { return node == other.node && offset == other.offset; }
+        bool operator!=(const ListIterator& other) const { return !(*this == other); }
+    private:
+        Node* node;
+        size_t offset;
+    };
+
+    class ConstListIterator {
+    public:
+        ConstListIterator(const Node* node, size_t offset) : node(node), offset(offset) {}
+
+        const T& operator*() const { return node->items[offset]; }
+        const T* operator->() const { return &node->items[offset]; }
+
+        ConstListIterator& operator++() {
+            if (++offset == node->count) {
+                node = node->next;
+                offset = 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const ConstListIterator& other) const { return node == other.node && offset == other.offset; }
+        bool operator!=(const ConstListIterator& other) const { return !(*this == other); }
+    private:
+        const Node* node;
+        size_t offset;
+    };
+
+    ListIterator begin() { return ListIterator(head, 0); }
+    ListIterator end() { return ListIterator(nullptr, 0); }
+    ConstListIterator begin() const { return ConstListIterator(head, 0); }
+    ConstListIterator end() const { return ConstListIterator(nullptr, 0); }
+};
+
+template <typename T, size_t NodeCapacity>
+void UnrolledListSequence<T, NodeCapacity>::CheckIndex(size_t index) const {
+    if (index >= size || size == 0) {
+        throw std::out_of_range("Index " + std::to_string(index) + " is out of range");
+    }
+}
+
+template <typename T, size_t NodeCapacity>
+typename UnrolledListSequence<T, NodeCapacity>::Node* UnrolledListSequence<T, NodeCapacity>::FindNode(size_t& index) const {
+    Node* node;
+    size_t start;
+
+    size_t from_tail = size - 1 - index;
+    size_t from_finger = finger ? (index > finger_start ? index - finger_start : finger_start - index) : size;
+
+    if (from_finger <= index && from_finger <= from_tail) {
+        node = finger;
+        start = finger_start;
+    } else if (index <= from_tail) {
+        node = head;
+        start = 0;
+    } else {
+        node = tail;
+        start = size - tail->count;
+    }
+
+    while (index >= start + node->count) {
+        start += node->count;
+        node = node->next;
+    }
+
+    while (index < start) {
+        node = node->prev;
+        start -= node->count;
+    }
+
+    finger = node;
+    finger_start = start;
+    index -= start;
+
+    return node;
+}
+
+template <typename T, size_t NodeCapacity>
+typename UnrolledListSequence<T, NodeCapacity>::Node* UnrolledListSequence<T, NodeCapacity>::InsertNodeAfter(Node* node) {
+    Node* new_node = new Node();
+
+    if (!node) {
+        new_node->next = head;
+        if (head) {
+            head->prev = new_node;
+        } else {
+            tail = new_node;
+        }
+        head = new_node;
+    } else {
+        new_node->prev = node;
+        new_node->next = node->next;
+        if (node->next) {
+            node->next->prev = new_node;
+        } else {
+            tail = new_node;
+        }
+        node->next = new_node;
+    }
+
+    node_count++;
+    return new_node;
+}
+
+template <typename T, size_t NodeCapacity>
+void UnrolledListSequence<T, NodeCapacity>::UnlinkNode(Node* node) {
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        head = node->next;
+    }
+
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        tail = node->prev;
+    }
+
+    delete node;
+    node_count--;
+}
+
+template <typename T, size_t NodeCapacity>
+void UnrolledListSequence<T, NodeCapacity>::Clear() {
+    Node* current_node = head;
+
+    while (current_node) {
+        Node* next_node = current_node->next;
+
+        delete current_node;
+
+        current_node = next_node;
+    }
+
+    head = tail = finger = nullptr;
+    size = node_count = 0;
+}
+
+template <typename T, size_t NodeCapacity>
+UnrolledListSequence<T, NodeCapacity>::UnrolledListSequence(T* items, size_t size) {
+    if (items == nullptr && size != 0) {
+        throw std::invalid_argument("Nullptr with non-zero size");
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        Append(items[i]);
+    }
+}
+
+template <typename T, size_t NodeCapacity>
+UnrolledListSequence<T, NodeCapacity>::UnrolledListSequence(const UnrolledListSequence<T, NodeCapacity>& list_sequence) {
+    for (const T& value : list_sequence) {
+        Append(value);
+    }
+}
+
+template <typename T, size_t NodeCapacity>
+UnrolledListSequence<T, NodeCapacity>& UnrolledListSequence<T, NodeCapacity>::operator=(const UnrolledListSequence& list_sequence) {
+    if (this != &list_sequence) {
+        Clear();
+
+        for (const T& value : list_sequence) {
+            Append(value);
+        }
+    }
+
+    return *this;
+}
+
+template <typename T, size_t NodeCapacity>
+UnrolledListSequence<T, NodeCapacity>& UnrolledListSequence<T, NodeCapacity>::operator=(UnrolledListSequence&& list_sequence) {
+    if (this != &list_sequence) {
+        Clear();
+
+        head = list_sequence.head;
+        tail = list_sequence.tail;
+        size = list_sequence.size;
+        node_count = list_sequence.node_count;
+
+        list_sequence.head = list_sequence.tail = list_sequence.finger = nullptr;
+        list_sequence.size = list_sequence.node_count = 0;
+    }
+
+    return *this;
+}
+
+template <typename T, size_t NodeCapacity>
+UnrolledListSequence<T, NodeCapacity>::~UnrolledListSequence() {
+    Clear();
+}
+
+template <typename T, size_t NodeCapacity>
+T& UnrolledListSequence<T, NodeCapacity>::GetFirst() {
+    return const_cast<T&>(static_cast<const UnrolledListSequence<T, NodeCapacity>*>(this)->GetFirst());
+}
+
+template <typename T, size_t NodeCapacity>
+const T& UnrolledListSequence<T, NodeCapacity>::GetFirst() const {
+    if (!head) {
+        throw std::out_of_range("No head of list");
+    }
+
+    return head->items[0];
+}
+
+template <typename T, size_t NodeCapacity>
+T& UnrolledListSequence<T, NodeCapacity>::GetLast() {
+    return const_cast<T&>(static_cast<const UnrolledListSequence<T, NodeCapacity>*>(this)->GetLast());
+}
+
+template <typename T, size_t NodeCapacity>
+const T& UnrolledListSequence<T, NodeCapacity>::GetLast() const {
+    if (!tail) {
+        throw std::out_of_range("No tail of list");
+    }
+
+    return tail->items[tail->count - 1];
+}
+
+template <typename T, size_t NodeCapacity>
+T& UnrolledListSequence<T, NodeCapacity>::Get(size_t index) {
+    CheckIndex(index);
+
+    Node* node = FindNode(index);
+    return node->items[index];
+}
+
+template <typename T, size_t NodeCapacity>
+const T& UnrolledListSequence<T, NodeCapacity>::Get(size_t index) const {
+    CheckIndex(index);
+
+    Node* node = FindNode(index);
+    return node->items[index];
+}
+
+template <typename T, size_t NodeCapacity>
+T& UnrolledListSequence<T, NodeCapacity>::operator[](size_t index) {
+    return Get(index);
+}
+
+template <typename T, size_t NodeCapacity>
+const T& UnrolledListSequence<T, NodeCapacity>::operator[](size_t index) const {
+    return Get(index);
+}
+
+template <typename T, size_t NodeCapacity>
+UnrolledListSequence<T, NodeCapacity>* UnrolledListSequence<T, NodeCapacity>::GetSubsequence(size_t start_index, size_t end_index) const {
+    if (start_index > end_index || end_index >= size) {
+        throw std::out_of_range("Indexes from " + std::to_string(start_index) + " to " + std::to_string(end_index) + " are out of range");
+    }
+
+    UnrolledListSequence<T, NodeCapacity>* sub_sequence = new UnrolledListSequence<T, NodeCapacity>();
+
+    size_t offset = start_index;
+    const Node* node = FindNode(offset);
+
+    for (size_t i = start_index; i <= end_index; i++) {
+        sub_sequence->Append(node->items[offset]);
+
+        if (++offset == node->count) {
+            node = node->next;
+            offset = 0;
+        }
+    }
+
+    return sub_sequence;
+}
+
+template <typename T, size_t NodeCapacity>
+size_t UnrolledListSequence<T, NodeCapacity>::GetSize() const {
+    return size;
+}
+
+template <typename T, size_t NodeCapacity>
+size_t UnrolledListSequence<T, NodeCapacity>::GetNodeCount() const {
+    return node_count;
+}
+
+template <typename T, size_t NodeCapacity>
+void UnrolledListSequence<T, NodeCapacity>::Append(const T& value) {
+    if (!tail || tail->count == NodeCapacity) {
+        InsertNodeAfter(tail);
+    }
+
+    tail->items[tail->count] = value;
+    tail->count++;
+    size++;
+}
+
+template <typename T, size_t NodeCapacity>
+void UnrolledListSequence<T, NodeCapacity>::Prepend(const T& value) {
+    InsertAt(value, 0);
+}
+
+template <typename T, size_t NodeCapacity>
+void UnrolledListSequence<T, NodeCapacity>::InsertAt(const T& value, size_t index) {
+    if (index == size) {
+        Append(value);
+        return;
+    }
+
+    CheckIndex(index);
+
+    Node* node = FindNode(index);
+    size_t start = finger_start;
+
+    if (node->count == NodeCapacity) {
+        if (index == 0 && (!node->prev || node->prev->count == NodeCapacity)) {
+            // Prepending to a full node starts a fresh one instead of splitting it.
+            Node* new_node = InsertNodeAfter(node->prev);
+            new_node->items[0] = value;
+            new_node->count = 1;
+            size++;
+
+            finger = new_node;
+            return;
+        }
+
+        if (index == 0) {
+            node = node->prev;
+            index = node->count;
+            start -= node->count;
+        } else {
+            Node* new_node = InsertNodeAfter(node);
+            size_t half = NodeCapacity / 2;
+
+            for (size_t i = half; i < NodeCapacity; i++) {
+                new_node->items[i - half] = node->items[i];
+            }
+
+            new_node->count = NodeCapacity - half;
+            node->count = half;
+
+            if (index > half) {
+                node = new_node;
+                index -= half;
+                start += half;
+            }
+        }
+    }
+
+    for (size_t i = node->count; i > index; i--) {
+        node->items[i] = node->items[i - 1];
+    }
+
+    node->items[index] = value;
+    node->count++;
+    size++;
+
+    finger = node;
+    finger_start = start;
+}
+
+template <typename T, size_t NodeCapacity>
+UnrolledListSequence<T, NodeCapacity>* UnrolledListSequence<T, NodeCapacity>::Concat(const Sequence<T>* sequence) const {
+    if (!sequence || sequence->GetSize() == 0) {
+        throw std::invalid_argument("Argument is nullptr or empty");
+    }
+
+    UnrolledListSequence<T, NodeCapacity>* result = new UnrolledListSequence<T, NodeCapacity>(*this);
+
+    for (size_t i = 0; i < sequence->GetSize(); i++) {
+        result->Append(sequence->Get(i));
+    }
+
+    return result;
+}
+
+template <typename T, size_t NodeCapacity>
+void UnrolledListSequence<T, NodeCapacity>::RemoveNode(size_t index) {
+    CheckIndex(index);
+
+    Node* node = FindNode(index);
+
+    for (size_t i = index + 1; i < node->count; i++) {
+        node->items[i - 1] = node->items[i];
+    }
+
+    node->count--;
+    size--;
+
+    if (node->count == 0) {
+        finger = nullptr;
+        UnlinkNode(node);
+        return;
+    }
+
+    Node* next_node = node->next;
+
+    if (node->count < NodeCapacity / 2 && next_node && node->count + next_node->count <= NodeCapacity) {
+        for (size_t i = 0; i < next_node->count; i++) {
+            node->items[node->count + i] = next_node->items[i];
+        }
+
+        node->count += next_node->count;
+        UnlinkNode(next_node);
+    }
+}
+
+#endif
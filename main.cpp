@@ -1,119 +1,177 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
 #include "SegmentDeque.hpp"
+#include "DequeIO.hpp"
 #include "Tests.hpp"
+#include "Benchmark.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 class InteractiveDeque {
 private:
     SegmentDeque<int> deque;
+    bool interactive;
+    bool timing;
+    std::ostream* out;
+    std::ostream quiet;
+    size_t executed;
 
     void ShowHelp() {
-        std::cout << "\nAvailable commands:\n";
-        std::cout << "  help                    - Show this help menu\n";
-        std::cout << "  deque <values...>       - Create new deque with given values\n";
-        std::cout << "  append <value>          - Add value to the end\n";
-        std::cout << "  prepend <value>         - Add value to the beginning\n";
-        std::cout << "  pop_back                - Remove last element\n";
-        std::cout << "  pop_front               - Remove first element\n";
-        std::cout << "  get <index>             - Get element at index\n";
-        std::cout << "  set <index> <value>     - Set element at index to value\n";
-        std::cout << "  print                   - Print current deque\n";
-        std::cout << "  size                    - Show deque size\n";
-        std::cout << "  empty                   - Check if deque is empty\n";
-        std::cout << "  clear                   - Clear the deque\n";
-        std::cout << "  map <operation>         - Apply operation to all elements (double, square, abs)\n";
-        std::cout << "  filter <condition>      - Filter elements (even, odd, positive, negative)\n";
-        std::cout << "  reduce <operation>      - Reduce deque to single value (sum, product, max, min)\n";
-        std::cout << "  iterate                 - Show elements using iterator\n";
-        std::cout << "  segments                - Show segment information\n";
-        std::cout << "  exit                    - Exit the program\n\n";
+        *out << "\nAvailable commands:\n";
+        *out << "  help                    - Show this help menu\n";
+        *out << "  deque <values...>       - Create new deque with given values\n";
+        *out << "  append <value>          - Add value to the end\n";
+        *out << "  prepend <value>         - Add value to the beginning\n";
+        *out << "  pop_back                - Remove last element\n";
+        *out << "  pop_front               - Remove first element\n";
+        *out << "  get <index>             - Get element at index\n";
+        *out << "  set <index> <value>     - Set element at index to value\n";
+        *out << "  print                   - Print current deque\n";
+        *out << "  print head <n>          - Print the first n elements\n";
+        *out << "  print tail <n>          - Print the last n elements\n";
+        *out << "  print range <a> <b>     - Print elements with indices in [a, b)\n";
+        *out << "  size                    - Show deque size\n";
+        *out << "  empty                   - Check if deque is empty\n";
+        *out << "  clear                   - Clear the deque\n";
+        *out << "  map <operation>         - Apply operation to all elements (double, square, abs)\n";
+        *out << "  filter <condition>      - Filter elements (even, odd, positive, negative)\n";
+        *out << "  reduce <operation>      - Reduce deque to single value (sum, product, max, min)\n";
+        *out << "  sort [desc]             - Sort the deque in ascending (or descending) order\n";
+        *out << "  iterate                 - Show elements using iterator\n";
+        *out << "  segments                - Show segment information and memory usage\n";
+        *out << "  load <file>             - Replace the deque with integers read from file\n";
+        *out << "  save <file>             - Write the deque to file, one integer per line\n";
+        *out << "  repeat <count> <command> - Run a command count times without its output\n";
+        *out << "  exit                    - Exit the program\n\n";
     }
 
     void PrintDeque() {
         if (deque.IsEmpty()) {
-            std::cout << "Deque is empty\n";
+            *out << "Deque is empty\n";
+            return;
+        }
+
+        *out << "Deque: [";
+        deque.WriteTo(*out, ", ");
+        *out << "]\n";
+    }
+
+    // print [head <n> | tail <n> | range <a> <b>]; head and tail are clamped to the size.
+    void HandlePrint(const std::vector<std::string>& tokens) {
+        if (tokens.size() == 1) {
+            PrintDeque();
             return;
         }
 
-        std::cout << "Deque: [";
+        size_t begin;
+        size_t end;
+
+        try {
+            if (tokens[1] == "head" && tokens.size() == 3) {
+                begin = 0;
+                end = std::min<size_t>(std::stoull(tokens[2]), deque.GetSize());
+            } else if (tokens[1] == "tail" && tokens.size() == 3) {
+                end = deque.GetSize();
+                begin = end - std::min<size_t>(std::stoull(tokens[2]), end);
+            } else if (tokens[1] == "range" && tokens.size() == 4) {
+                begin = std::stoull(tokens[2]);
+                end = std::stoull(tokens[3]);
+            } else {
+                *out << "Usage: print [head <n> | tail <n> | range <a> <b>]\n";
+                return;
+            }
+        } catch (const std::exception&) {
+            *out << "Invalid number\n";
+            return;
+        }
 
-        for (size_t i = 0; i < deque.GetSize(); i++) {
-            std::cout << deque.Get(i);
-            if (i < deque.GetSize() - 1) std::cout << ", ";
+        if (begin > end || end > deque.GetSize()) {
+            *out << "Range [" << begin << ", " << end << ") is out of range for deque of size " << deque.GetSize() << "\n";
+            return;
         }
 
-        std::cout << "]\n";
+        *out << "Elements [" << begin << ", " << end << "): [";
+        deque.WriteTo(*out, ", ", begin, end);
+        *out << "]\n";
     }
 
     void CreateDeque(const std::vector<std::string>& tokens) {
-        deque = SegmentDeque<int>();
+        deque.Clear();
 
         for (size_t i = 1; i < tokens.size(); i++) {
             try {
                 int value = std::stoi(tokens[i]);
                 deque.Append(value);
             } catch (const std::exception&) {
-                std::cout << "Invalid number: " << tokens[i] << "\n";
+                *out << "Invalid number: " << tokens[i] << "\n";
                 return;
             }
         }
 
-        std::cout << "Created deque with " << deque.GetSize() << " elements\n";
+        *out << "Created deque with " << deque.GetSize() << " elements\n";
         PrintDeque();
     }
 
     void HandleAppend(const std::vector<std::string>& tokens) {
         if (tokens.size() != 2) {
-            std::cout << "Usage: append <value>\n";
+            *out << "Usage: append <value>\n";
             return;
         }
 
         try {
             int value = std::stoi(tokens[1]);
             deque.Append(value);
-            std::cout << "Appended " << value << "\n";
+            *out << "Appended " << value << "\n";
         } catch (const std::exception&) {
-            std::cout << "Invalid number: " << tokens[1] << "\n";
+            *out << "Invalid number: " << tokens[1] << "\n";
         }
     }
 
     void HandlePrepend(const std::vector<std::string>& tokens) {
         if (tokens.size() != 2) {
-            std::cout << "Usage: prepend <value>\n";
+            *out << "Usage: prepend <value>\n";
             return;
         }
 
         try {
             int value = std::stoi(tokens[1]);
             deque.Prepend(value);
-            std::cout << "Prepended " << value << "\n";
+            *out << "Prepended " << value << "\n";
         } catch (const std::exception&) {
-            std::cout << "Invalid number: " << tokens[1] << "\n";
+            *out << "Invalid number: " << tokens[1] << "\n";
         }
     }
 
     void HandleGet(const std::vector<std::string>& tokens) {
         if (tokens.size() != 2) {
-            std::cout << "Usage: get <index>\n";
+            *out << "Usage: get <index>\n";
             return;
         }
 
         try {
             size_t index = std::stoull(tokens[1]);
             int value = deque.Get(index);
-            std::cout << "Element at index " << index << ": " << value << "\n";
+            *out << "Element at index " << index << ": " << value << "\n";
         } catch (const std::out_of_range&) {
-            std::cout << "Index out of range\n";
+            *out << "Index out of range\n";
         } catch (const std::exception&) {
-            std::cout << "Invalid index: " << tokens[1] << "\n";
+            *out << "Invalid index: " << tokens[1] << "\n";
         }
     }
 
     void HandleSet(const std::vector<std::string>& tokens) {
         if (tokens.size() != 3) {
-            std::cout << "Usage: set <index> <value>\n";
+            *out << "Usage: set <index> <value>\n";
             return;
         }
 
@@ -121,117 +179,129 @@ private:
             size_t index = std::stoull(tokens[1]);
             int value = std::stoi(tokens[2]);
             deque.Get(index) = value;
-            std::cout << "Set element at index " << index << " to " << value << "\n";
+            *out << "Set element at index " << index << " to " << value << "\n";
         } catch (const std::out_of_range&) {
-            std::cout << "Index out of range\n";
+            *out << "Index out of range\n";
         } catch (const std::exception&) {
-            std::cout << "Invalid parameters\n";
+            *out << "Invalid parameters\n";
         }
     }
 
     void HandleMap(const std::vector<std::string>& tokens) {
         if (tokens.size() != 2) {
-            std::cout << "Usage: map <operation> (double, square, abs)\n";
+            *out << "Usage: map <operation> (double, square, abs)\n";
             return;
         }
 
         if (tokens[1] == "double") {
-            deque = deque.Map([](int x) { return x * 2; });
-            std::cout << "Applied double operation\n";
+            deque.Transform([](int x) { return x * 2; });
+            *out << "Applied double operation\n";
         } else if (tokens[1] == "square") {
-            deque = deque.Map([](int x) { return x * x; });
-            std::cout << "Applied square operation\n";
+            deque.Transform([](int x) { return x * x; });
+            *out << "Applied square operation\n";
         } else if (tokens[1] == "abs") {
-            deque = deque.Map([](int x) { return x < 0 ? -x : x; });
-            std::cout << "Applied absolute value operation\n";
+            deque.Transform([](int x) { return x < 0 ? -x : x; });
+            *out << "Applied absolute value operation\n";
         } else {
-            std::cout << "Unknown operation. Available: double, square, abs\n";
+            *out << "Unknown operation. Available: double, square, abs\n";
         }
     }
 
     void HandleFilter(const std::vector<std::string>& tokens) {
         if (tokens.size() != 2) {
-            std::cout << "Usage: filter <condition> (even, odd, positive, negative)\n";
+            *out << "Usage: filter <condition> (even, odd, positive, negative)\n";
             return;
         }
 
         if (tokens[1] == "even") {
-            deque = deque.Where([](int x) { return x % 2 == 0; });
-            std::cout << "Filtered even numbers\n";
+            deque.Retain([](int x) { return x % 2 == 0; });
+            *out << "Filtered even numbers\n";
         } else if (tokens[1] == "odd") {
-            deque = deque.Where([](int x) { return x % 2 != 0; });
-            std::cout << "Filtered odd numbers\n";
+            deque.Retain([](int x) { return x % 2 != 0; });
+            *out << "Filtered odd numbers\n";
         } else if (tokens[1] == "positive") {
-            deque = deque.Where([](int x) { return x > 0; });
-            std::cout << "Filtered positive numbers\n";
+            deque.Retain([](int x) { return x > 0; });
+            *out << "Filtered positive numbers\n";
         } else if (tokens[1] == "negative") {
-            deque = deque.Where([](int x) { return x < 0; });
-            std::cout << "Filtered negative numbers\n";
+            deque.Retain([](int x) { return x < 0; });
+            *out << "Filtered negative numbers\n";
         } else {
-            std::cout << "Unknown condition. Available: even, odd, positive, negative\n";
+            *out << "Unknown condition. Available: even, odd, positive, negative\n";
         }
     }
 
     void HandleReduce(const std::vector<std::string>& tokens) {
         if (tokens.size() != 2) {
-            std::cout << "Usage: reduce <operation> (sum, product, max, min)\n";
+            *out << "Usage: reduce <operation> (sum, product, max, min)\n";
             return;
         }
 
         if (deque.IsEmpty()) {
-            std::cout << "Cannot reduce empty deque\n";
+            *out << "Cannot reduce empty deque\n";
             return;
         }
 
         if (tokens[1] == "sum") {
             int result = deque.Reduce([](int acc, int x) { return acc + x; }, 0);
-            std::cout << "Sum: " << result << "\n";
+            *out << "Sum: " << result << "\n";
         } else if (tokens[1] == "product") {
             int result = deque.Reduce([](int acc, int x) { return acc * x; }, 1);
-            std::cout << "Product: " << result << "\n";
+            *out << "Product: " << result << "\n";
         } else if (tokens[1] == "max") {
             int result = deque.Reduce([](int acc, int x) { return acc > x ? acc : x; }, deque.Get(0));
-            std::cout << "Max: " << result << "\n";
+            *out << "Max: " << result << "\n";
         } else if (tokens[1] == "min") {
             int result = deque.Reduce([](int acc, int x) { return acc < x ? acc : x; }, deque.Get(0));
-            std::cout << "Min: " << result << "\n";
+            *out << "Min: " << result << "\n";
         } else {
-            std::cout << "Unknown operation. Available: sum, product, max, min\n";
+            *out << "Unknown operation. Available: sum, product, max, min\n";
         }
     }
 
     void HandleIterate() {
         if (deque.IsEmpty()) {
-            std::cout << "Deque is empty\n";
+            *out << "Deque is empty\n";
             return;
         }
 
-        std::cout << "Iterating through deque: ";
+        *out << "Iterating through deque: ";
         Iterator<int>* it = deque.GetIterator();
         bool first = true;
 
         while (it->Next()) {
             if (!first) {
-                std::cout << ", ";
+                *out << ", ";
             }
 
-            std::cout << it->Get();
+            *out << it->Get();
             first = false;
         }
 
-        std::cout << "\n";
+        *out << "\n";
         delete it;
     }
 
     void ShowSegments() {
-        std::cout << "Segment count: " << deque.GetSegmentCount() << "\n";
+        *out << "Segment count: " << deque.GetSegmentCount()
+                  << (deque.IsInline() ? " (inline)" : "") << "\n";
         for (size_t i = 0; i < deque.GetSegmentCount(); i++) {
             const Segment<int>* segment = deque.GetSegment(i);
 
-            std::cout << "Segment " << i << ": front_offset=" << segment->front_offset 
+            *out << "Segment " << i << ": front_offset=" << segment->front_offset 
                     << ", back_size=" << segment->back_size 
-                    << ", effective_size=" << segment->GetEffectiveSize() << "\n";
+                    << ", effective_size=" << segment->GetEffectiveSize()
+                    << ", capacity=" << segment->capacity << "\n";
+        }
+
+        DequeMemoryUsage usage = deque.MemoryUsage();
+        *out << "Memory: payload=" << usage.payload_bytes << " B, slack=" << usage.slack_bytes
+             << " B, metadata=" << usage.metadata_bytes << " B, total=" << usage.GetTotalBytes() << " B\n";
+        *out << "Segment fill:";
+        for (size_t i = 0; i < DequeMemoryUsage::FILL_BUCKETS; i++) {
+            *out << " " << 100 * i / DequeMemoryUsage::FILL_BUCKETS << "-"
+                 << 100 * (i + 1) / DequeMemoryUsage::FILL_BUCKETS << "%: " << usage.fill_histogram[i];
         }
+        *out << "\n";
     }
 
     std::vector<std::string> TokenizeInput(const std::string& input) {
@@ -246,84 +316,255 @@ private:
         return tokens;
     }
 
-public:
-    void Run() {
-        std::cout << "SegmentDeque Interactive Menu\n";
+    void HandleFile(const std::vector<std::string>& tokens) {
+        if (tokens.size() != 2) {
+            *out << "Usage: " << tokens[0] << " <file>\n";
+            return;
+        }
+
+        if (tokens[0] == "load") {
+            size_t count = DequeIO::LoadIntegers(tokens[1], deque);
+            *out << "Loaded " << count << " elements from " << tokens[1] << "\n";
+        } else {
+            size_t count = DequeIO::SaveIntegers(tokens[1], deque);
+            *out << "Saved " << count << " elements to " << tokens[1] << "\n";
+        }
+    }
+
+    // Runs one command line and counts it in `executed` if it completes.
+    // Returns false when the command asks to exit.
+    bool ExecuteCommand(const std::vector<std::string>& tokens) {
+        std::string command = tokens[0];
+
+        try {
+            if (command == "help") {
+                ShowHelp();
+            } else if (command == "exit") {
+                *out << "Goodbye!\n";
+                return false;
+            } else if (command == "repeat") {
+                // Counts the commands it runs, not itself.
+                HandleRepeat(tokens);
+                return true;
+            } else if (command == "deque") {
+                CreateDeque(tokens);
+            } else if (command == "append") {
+                HandleAppend(tokens);
+            } else if (command == "prepend") {
+                HandlePrepend(tokens);
+            } else if (command == "pop_back") {
+                if (deque.IsEmpty()) {
+                    *out << "Deque is empty\n";
+                } else {
+                    deque.PopBack();
+                    *out << "Popped back element\n";
+                }
+            } else if (command == "pop_front") {
+                if (deque.IsEmpty()) {
+                    *out << "Deque is empty\n";
+                } else {
+                    deque.PopFront();
+                    *out << "Popped front element\n";
+                }
+            } else if (command == "get") {
+                HandleGet(tokens);
+            } else if (command == "set") {
+                HandleSet(tokens);
+            } else if (command == "print") {
+                HandlePrint(tokens);
+            } else if (command == "size") {
+                *out << "Size: " << deque.GetSize() << "\n";
+            } else if (command == "empty") {
+                *out << "Empty: " << (deque.IsEmpty() ? "true" : "false") << "\n";
+            } else if (command == "clear") {
+                deque.Clear();
+                *out << "Deque cleared\n";
+            } else if (command == "map") {
+                HandleMap(tokens);
+            } else if (command == "filter") {
+                HandleFilter(tokens);
+            } else if (command == "reduce") {
+                HandleReduce(tokens);
+            } else if (command == "sort") {
+                if (tokens.size() > 1 && tokens[1] == "desc") {
+                    deque.Sort([](int a, int b) { return a > b; });
+                } else {
+                    deque.Sort();
+                }
+                *out << "Sorted " << deque.GetSize() << " elements\n";
+            } else if (command == "load" || command == "save") {
+                HandleFile(tokens);
+            } else if (command == "iterate") {
+                HandleIterate();
+            } else if (command == "segments") {
+                ShowSegments();
+            } else {
+                *out << "Unknown command: " << command << ". Type 'help' for available commands.\n";
+                return true;
+            }
+
+            executed++;
+        } catch (const std::exception& e) {
+            *out << "Error: " << e.what() << "\n";
+        }
+
+        return true;
+    }
+
+    // repeat <count> <command...>: the repeated command's own output is dropped.
+    void HandleRepeat(const std::vector<std::string>& tokens) {
+        if (tokens.size() < 3) {
+            *out << "Usage: repeat <count> <command>\n";
+            return;
+        }
+
+        size_t count;
+        try {
+            count = std::stoull(tokens[1]);
+        } catch (const std::exception&) {
+            *out << "Invalid count: " << tokens[1] << "\n";
+            return;
+        }
+
+        std::vector<std::string> command(tokens.begin() + 2, tokens.end());
+        if (command[0] == "repeat" || command[0] == "exit") {
+            *out << "Cannot repeat " << command[0] << "\n";
+            return;
+        }
+
+        std::ostream* previous = out;
+        out = &quiet;
 
-        ShowHelp();
+        for (size_t i = 0; i < count; i++) {
+            ExecuteCommand(command);
+        }
+
+        out = previous;
+        *out << "Repeated " << command[0] << " " << count << " times\n";
+    }
+
+public:
+    // In non-interactive mode (scripts, piped input) there is no banner and no prompt;
+    // with timing on, every command is followed by its wall-clock time and rate.
+    explicit InteractiveDeque(bool interactive = true, bool timing = false)
+        : interactive(interactive), timing(timing), out(&std::cout), quiet(nullptr), executed(0) {}
+
+    void Run(std::istream& input = std::cin) {
+        if (interactive) {
+            *out << "SegmentDeque Interactive Menu\n";
+            ShowHelp();
+        }
 
-        std::string input;
+        std::string line;
         while (true) {
-            std::cout << "deque> ";
-            std::getline(std::cin, input);
+            if (interactive) {
+                *out << "deque> ";
+            }
 
-            if (input.empty()) continue;
+            if (!std::getline(input, line)) {
+                break;
+            }
 
-            std::vector<std::string> tokens = TokenizeInput(input);
-            if (tokens.empty()) continue;
+            std::vector<std::string> tokens = TokenizeInput(line);
+            if (tokens.empty() || tokens[0][0] == '#') continue;
 
-            std::string command = tokens[0];
+            size_t executed_before = executed;
+            auto start = std::chrono::steady_clock::now();
+            bool keep_running = ExecuteCommand(tokens);
+            auto finish = std::chrono::steady_clock::now();
 
-            try {
-                if (command == "help") {
-                    ShowHelp();
-                } else if (command == "exit") {
-                    std::cout << "Goodbye!\n";
-                    break;
-                } else if (command == "deque") {
-                    CreateDeque(tokens);
-                } else if (command == "append") {
-                    HandleAppend(tokens);
-                } else if (command == "prepend") {
-                    HandlePrepend(tokens);
-                } else if (command == "pop_back") {
-                    if (deque.IsEmpty()) {
-                        std::cout << "Deque is empty\n";
-                    } else {
-                        deque.PopBack();
-                        std::cout << "Popped back element\n";
-                    }
-                } else if (command == "pop_front") {
-                    if (deque.IsEmpty()) {
-                        std::cout << "Deque is empty\n";
-                    } else {
-                        deque.PopFront();
-                        std::cout << "Popped front element\n";
-                    }
-                } else if (command == "get") {
-                    HandleGet(tokens);
-                } else if (command == "set") {
-                    HandleSet(tokens);
-                } else if (command == "print") {
-                    PrintDeque();
-                } else if (command == "size") {
-                    std::cout << "Size: " << deque.GetSize() << "\n";
-                } else if (command == "empty") {
-                    std::cout << "Empty: " << (deque.IsEmpty() ? "true" : "false") << "\n";
-                } else if (command == "clear") {
-                    deque = SegmentDeque<int>();
-                    std::cout << "Deque cleared\n";
-                } else if (command == "map") {
-                    HandleMap(tokens);
-                } else if (command == "filter") {
-                    HandleFilter(tokens);
-                } else if (command == "reduce") {
-                    HandleReduce(tokens);
-                } else if (command == "iterate") {
-                    HandleIterate();
-                } else if (command == "segments") {
-                    ShowSegments();
-                } else {
-                    std::cout << "Unknown command: " << command << ". Type 'help' for available commands.\n";
+            if (timing) {
+                double seconds = std::chrono::duration<double>(finish - start).count();
+                size_t operations = executed - executed_before;
+
+                // Formatted separately so the fixed precision does not stick to *out.
+                std::ostringstream report;
+                report << "[time] " << line << ": " << std::fixed << std::setprecision(3) << seconds * 1000 << " ms";
+                if (seconds > 0 && operations > 0) {
+                    report << ", " << std::setprecision(0) << operations / seconds << " ops/sec";
                 }
-            } catch (const std::exception& e) {
-                std::cout << "Error: " << e.what() << "\n";
+                *out << report.str() << "\n";
+            }
+
+            if (!keep_running) {
+                break;
             }
         }
     }
 };
 
-int main() {
+static bool IsInteractiveInput() {
+#ifdef _WIN32
+    return _isatty(_fileno(stdin));
+#else
+    return isatty(fileno(stdin));
+#endif
+}
+
+static void ShowUsage(const char* program) {
+    std::cout << "Usage: " << program << " [--bench | --test | --scalability | [--script <file>] [--time]]\n"
+              << "  --bench          run benchmarks\n"
+              << "  --test           run unit tests only\n"
+              << "  --scalability    check that operations keep their expected complexity\n"
+              << "  --script <file>  run commands from file without prompts or startup tests\n"
+              << "  --time           print wall-clock time and ops/sec after every command\n"
+              << "Commands piped through stdin run the same way as --script.\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string script;
+    bool timing = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+
+        if (argument == "--bench") {
+            RunDequeBenchmarks();
+            return 0;
+        } else if (argument == "--test") {
+            try {
+                RunDequeTests();
+            } catch (const std::exception& e) {
+                std::cout << "Test failed: " << e.what() << "\n";
+                return 1;
+            }
+            return 0;
+        } else if (argument == "--scalability") {
+            try {
+                RunDequeScalabilityTests();
+            } catch (const std::exception& e) {
+                std::cout << "Test failed: " << e.what() << "\n";
+                return 1;
+            }
+            return 0;
+        } else if (argument == "--script" && i + 1 < argc) {
+            script = argv[++i];
+        } else if (argument == "--time") {
+            timing = true;
+        } else {
+            ShowUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!script.empty()) {
+        std::ifstream input(script);
+        if (!input) {
+            std::cout << "Cannot open script: " << script << "\n";
+            return 1;
+        }
+
+        InteractiveDeque runner(false, timing);
+        runner.Run(input);
+        return 0;
+    }
+
+    if (!IsInteractiveInput()) {
+        InteractiveDeque runner(false, timing);
+        runner.Run();
+        return 0;
+    }
+
     std::cout << "Running tests\n";
 
     try {
@@ -335,8 +576,8 @@ int main() {
 
     std::cout << "\n";
 
-    InteractiveDeque menu;
+    InteractiveDeque menu(true, timing);
     menu.Run();
 
     return 0;
-}
\ No newline at end of file
+}